@@ -0,0 +1,157 @@
+#ifndef ALIGNMENT_CIGAR_HPP
+#define ALIGNMENT_CIGAR_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+// Alignment path as a list of CIGAR runs, with sequence 1 as the query and
+// sequence 2 as the reference (SAM's extended ops):
+//   '=' match, 'X' mismatch, 'I' base of seq1 against a gap, 'D' base of
+//   seq2 against a gap.
+// Tracebacks push runs end to start and reverse once. Column counts are
+// kept as runs are pushed; the gapped strings and match line are derived
+// from the runs when asked for.
+
+struct CigarRun {
+    char op;
+    size_t length;
+};
+
+// Column counts of an alignment. Every gap run (I or D) is one gap open.
+struct AlignmentStats {
+    size_t length = 0;
+    size_t matches = 0, mismatches = 0, gaps = 0;
+    size_t gapOpens = 0;
+
+    void add(char op, size_t count) {
+        length += count;
+        if (op == '=') {
+            matches += count;
+        } else if (op == 'X') {
+            mismatches += count;
+        } else {
+            gaps += count;
+        }
+    }
+
+    // Percent of the columns that are matches, 0 for an empty alignment
+    double identity() const {
+        return length == 0 ? 0.0 : 100.0 * matches / length;
+    }
+};
+
+class Cigar {
+private:
+    std::vector<CigarRun> runs;
+    AlignmentStats counts;
+    size_t deleted = 0;  // columns of D runs
+
+public:
+    // Place in a Cigar, for walking it block by block
+    struct Cursor {
+        size_t run = 0;
+        size_t offset = 0;  // columns of the run already passed
+    };
+
+    // Add count columns of op after the last run, merging with it
+    void push(char op, size_t count = 1) {
+        if (count == 0) return;
+        if (!runs.empty() && runs.back().op == op) {
+            runs.back().length += count;
+        } else {
+            runs.push_back({op, count});
+            if (op == 'I' || op == 'D') counts.gapOpens++;
+        }
+        counts.add(op, count);
+        if (op == 'D') deleted += count;
+    }
+
+    void append(const Cigar& other) {
+        for (const CigarRun& run : other.runs) push(run.op, run.length);
+    }
+
+    // Reverse the run order, for paths pushed from their end
+    void reverse() { std::reverse(runs.begin(), runs.end()); }
+
+    void clear() {
+        runs.clear();
+        counts = AlignmentStats();
+        deleted = 0;
+    }
+
+    bool empty() const { return runs.empty(); }
+    const std::vector<CigarRun>& operations() const { return runs; }
+
+    // Matches, mismatches, gaps and gap opens, counted as the runs were pushed
+    const AlignmentStats& stats() const { return counts; }
+
+    // Alignment columns
+    size_t length() const { return counts.length; }
+
+    // Bases of seq1 and seq2 the alignment covers
+    size_t span1() const { return counts.length - deleted; }
+    size_t span2() const { return counts.length - (counts.gaps - deleted); }
+
+    // SAM notation, "*" for an empty path
+    std::string str() const {
+        if (runs.empty()) return "*";
+        std::string text;
+        for (const CigarRun& run : runs) {
+            text += std::to_string(run.length);
+            text += run.op;
+        }
+        return text;
+    }
+
+    // Gapped rows of the alignment from the aligned parts of the two
+    // sequences (span1() and span2() bases)
+    void render(std::string_view part1, std::string_view part2, std::string& aligned1, std::string& aligned2) const {
+        aligned1.clear();
+        aligned2.clear();
+        aligned1.reserve(length());
+        aligned2.reserve(length());
+        size_t i = 0, j = 0;
+        for (const CigarRun& run : runs) {
+            if (run.op == 'D') {
+                aligned1.append(run.length, '-');
+            } else {
+                aligned1.append(part1.substr(i, run.length));
+                i += run.length;
+            }
+            if (run.op == 'I') {
+                aligned2.append(run.length, '-');
+            } else {
+                aligned2.append(part2.substr(j, run.length));
+                j += run.length;
+            }
+        }
+    }
+
+    // '|' under matches, ' ' elsewhere, for the next columns after cursor;
+    // the cursor moves past them
+    std::string matchLine(Cursor& cursor, size_t columns) const {
+        std::string line;
+        line.reserve(columns);
+        while (line.size() < columns && cursor.run < runs.size()) {
+            const CigarRun& run = runs[cursor.run];
+            size_t take = std::min(columns - line.size(), run.length - cursor.offset);
+            line.append(take, run.op == '=' ? '|' : ' ');
+            cursor.offset += take;
+            if (cursor.offset == run.length) {
+                cursor.run++;
+                cursor.offset = 0;
+            }
+        }
+        return line;
+    }
+
+    std::string matchLine() const {
+        Cursor cursor;
+        return matchLine(cursor, length());
+    }
+};
+
+#endif
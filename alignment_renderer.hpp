@@ -0,0 +1,207 @@
+#ifndef ALIGNMENT_RENDERER_HPP
+#define ALIGNMENT_RENDERER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <ostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <utility>
+
+// ANSI color codes
+namespace Color {
+    // Foreground colors
+    const char* const RED = "\033[31m";
+    const char* const GREEN = "\033[32m";
+    const char* const YELLOW = "\033[33m";
+    const char* const BLUE = "\033[34m";
+    const char* const MAGENTA = "\033[35m";
+    const char* const CYAN = "\033[36m";
+    const char* const WHITE = "\033[37m";
+
+    // Background colors
+    const char* const BG_RED = "\033[41m";
+    const char* const BG_GREEN = "\033[42m";
+    const char* const BG_YELLOW = "\033[43m";
+    const char* const BG_BLUE = "\033[44m";
+    const char* const BG_WHITE = "\033[47m";
+    const char* const BG_GRAY = "\033[40m";
+
+    // Formatting
+    const char* const BOLD = "\033[1m";
+    const char* const UNDERLINE = "\033[4m";
+    const char* const RESET = "\033[0m";
+}
+
+// How the line between the two sequences marks each column
+enum class MatchStyle {
+    Marks,       // '|' on green, 'x' on yellow, ' ' on red for gaps
+    BaseColored  // '|' in the base's color on gray, red 'X' on yellow, '-' on gray for gaps
+};
+
+// Draws an alignment as blocks of ruler, sequence 1, match line and
+// sequence 2. Every character's escape code comes from tables built once;
+// a run of characters with the same color gets one escape and one reset,
+// and blocks are assembled in a reused buffer that is written in one call
+// per FLUSH_BYTES of output. Without color the same layout is written as plain text, for files.
+class AlignmentRenderer {
+private:
+    static const size_t FLUSH_BYTES = 1 << 16;
+    static const size_t LABEL_WIDTH = 5;  // "Seq1 "
+
+    std::ostream& out;
+    bool color;
+    size_t lineLength;
+    std::vector<std::string> palette{""};  // escape per color index, 0 = uncolored
+    std::array<uint8_t, 256> baseColor{};   // color of a base in the sequence lines
+    std::array<uint8_t, 256> matchColor{};  // color of a matched column, by base
+    uint8_t mismatchColor = 0, gapColor = 0;
+    char mismatchGlyph = 'x', gapGlyph = ' ';
+    std::string rulerNumbers, rulerMarks;  // ruler of a full-length block
+    std::string labels[2];                 // "Seq1 ", "Seq2 " in bold
+    std::string buffer;
+
+    uint8_t addColor(const std::string& escape) {
+        if (!color) return 0;
+        auto it = std::find(palette.begin(), palette.end(), escape);
+        if (it != palette.end()) return static_cast<uint8_t>(it - palette.begin());
+        palette.push_back(escape);
+        return static_cast<uint8_t>(palette.size() - 1);
+    }
+
+    // Append c in color k; escapes are only written where the color changes
+    void put(char c, uint8_t k, uint8_t& current) {
+        if (k != current) {
+            if (current != 0) buffer += Color::RESET;
+            buffer += palette[k];
+            current = k;
+        }
+        buffer += c;
+    }
+
+    void endLine(uint8_t& current) {
+        if (current != 0) buffer += Color::RESET;
+        current = 0;
+        buffer += '\n';
+    }
+
+    // Ruler lines for a block of length columns: numbers ending at every
+    // tenth column, then '.', '+' every fifth and '|' every tenth column
+    void buildRuler(size_t length, std::string& numbers, std::string& marks) const {
+        numbers.assign(LABEL_WIDTH, ' ');
+        marks.assign(LABEL_WIDTH, ' ');
+        char label[24];
+        for (size_t i = 10; i <= length; i += 10) {
+            std::snprintf(label, sizeof(label), "%10zu", i);
+            numbers += label;
+        }
+        for (size_t i = 1; i <= length; ++i) {
+            marks += i % 10 == 0 ? '|' : i % 5 == 0 ? '+' : '.';
+        }
+    }
+
+    void appendLine(const std::string& text, const char* escape) {
+        buffer += code(escape);
+        buffer += text;
+        buffer += code(Color::RESET);
+        buffer += '\n';
+    }
+
+    void appendBlock(std::string_view seq1, std::string_view seq2, size_t start, size_t length) {
+        std::string numbers, marks;
+        if (length != lineLength) buildRuler(length, numbers, marks);
+        appendLine(length == lineLength ? rulerNumbers : numbers, Color::CYAN);
+        appendLine(length == lineLength ? rulerMarks : marks, Color::CYAN);
+
+        uint8_t current = 0;
+        std::string_view part1 = seq1.substr(start, length), part2 = seq2.substr(start, length);
+        buffer += labels[0];
+        for (char base : part1) put(base, baseColor[static_cast<unsigned char>(base)], current);
+        endLine(current);
+
+        buffer.append(LABEL_WIDTH, ' ');
+        for (size_t k = 0; k < length; ++k) {
+            char a = part1[k], b = part2[k];
+            if (a == '-' || b == '-') {
+                put(gapGlyph, gapColor, current);
+            } else if (a == b) {
+                put('|', matchColor[static_cast<unsigned char>(a)], current);
+            } else {
+                put(mismatchGlyph, mismatchColor, current);
+            }
+        }
+        endLine(current);
+
+        buffer += labels[1];
+        for (char base : part2) put(base, baseColor[static_cast<unsigned char>(base)], current);
+        endLine(current);
+        buffer += '\n';
+    }
+
+public:
+    AlignmentRenderer(std::ostream& output, bool useColor, size_t lineChars, MatchStyle style)
+        : out(output), color(useColor), lineLength(lineChars) {
+        const std::pair<char, const char*> bases[] = {
+            {'A', Color::RED}, {'T', Color::BLUE}, {'G', Color::GREEN}, {'C', Color::YELLOW}};
+        for (const auto& base : bases) {
+            baseColor[static_cast<unsigned char>(base.first)] = addColor(base.second);
+        }
+        baseColor['-'] = addColor(Color::MAGENTA);
+
+        if (style == MatchStyle::Marks) {
+            matchColor.fill(addColor(Color::BG_GREEN));
+            mismatchColor = addColor(Color::BG_YELLOW);
+            gapColor = addColor(Color::BG_RED);
+        } else {
+            // Matches of other characters get a plain '|'
+            for (const auto& base : bases) {
+                matchColor[static_cast<unsigned char>(base.first)] = addColor(std::string(Color::BG_GRAY) + base.second);
+            }
+            mismatchColor = addColor(std::string(Color::BG_YELLOW) + Color::RED);
+            gapColor = addColor(std::string(Color::BG_GRAY) + Color::WHITE);
+            mismatchGlyph = 'X';
+            gapGlyph = '-';
+        }
+
+        buildRuler(lineLength, rulerNumbers, rulerMarks);
+        for (int k = 0; k < 2; ++k) {
+            labels[k] = std::string(code(Color::BOLD)) + "Seq" + std::to_string(k + 1) + ' ' + code(Color::RESET);
+        }
+        // A flush happens at most one block past FLUSH_BYTES; a block line
+        // takes at most an escape, a reset and the character per column
+        buffer.reserve(FLUSH_BYTES + 5 * (lineLength + LABEL_WIDTH) * 24);
+    }
+
+    ~AlignmentRenderer() {
+        flush();
+    }
+
+    // The escape code, or nothing when writing plain text
+    const char* code(const char* escape) const { return color ? escape : ""; }
+
+    // A base in its sequence-line color, for legends
+    std::string paint(char base) const {
+        uint8_t k = baseColor[static_cast<unsigned char>(base)];
+        return k == 0 ? std::string(1, base) : palette[k] + base + Color::RESET;
+    }
+
+    // Every block of two aligned (equal-length) gapped strings
+    void renderBlocks(std::string_view seq1, std::string_view seq2) {
+        for (size_t start = 0; start < seq1.size(); start += lineLength) {
+            appendBlock(seq1, seq2, start, std::min(lineLength, seq1.size() - start));
+            if (buffer.size() >= FLUSH_BYTES) flush();
+        }
+        flush();
+    }
+
+    void flush() {
+        if (buffer.empty()) return;
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+};
+
+#endif
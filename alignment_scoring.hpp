@@ -0,0 +1,164 @@
+#ifndef ALIGNMENT_SCORING_HPP
+#define ALIGNMENT_SCORING_HPP
+
+#include <climits>
+#include <cstdlib>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <chrono>
+
+// Scoring shared by the aligners: substitution scores and affine gap costs.
+// A gap of length k scores -(gapOpen + (k - 1) * gapExtend). With equal
+// open and extend costs this is the original linear GAP_SCORE of -2.
+struct ScoringScheme {
+    int match = 1;
+    int mismatch = -1;
+    int gapOpen = 2;    // cost of the first gap position
+    int gapExtend = 2;  // cost of every further position
+
+    int substitution(char a, char b) const {
+        return a == b ? match : mismatch;
+    }
+
+    // Score of a gap run of the given length
+    int gap(size_t length) const {
+        return length == 0 ? 0 : -(gapOpen + static_cast<int>(length - 1) * gapExtend);
+    }
+
+    // Gotoh's recurrences (and the striped kernel) assume extending a gap
+    // never costs more than opening one
+    void validate() const {
+        if (gapExtend < 0 || gapOpen < gapExtend) {
+            throw std::runtime_error("Gap costs must satisfy gap-open >= gap-extend >= 0");
+        }
+    }
+};
+
+// "Minus infinity" for DP states that cannot be reached; leaves headroom so
+// subtracting gap costs never overflows
+const int NEG_INF = INT_MIN / 4;
+
+// Traceback flags kept next to a cell's direction. Gotoh's E (gap moving up,
+// consuming seq1) and F (gap moving left, consuming seq2) live in rolling rows
+// during the fill; only whether each one extended a gap instead of opening it
+// is stored, which is all the traceback needs to follow state changes.
+const unsigned char EXTEND_UP = 1;
+const unsigned char EXTEND_LEFT = 2;
+
+// Best of opening a gap from H or extending the running one, flagging an
+// extension. Opening wins ties, so equal costs follow the linear-gap paths.
+inline int gapState(int openScore, int extendScore, unsigned char extendFlag, unsigned char& flags) {
+    if (extendScore > openScore) {
+        flags |= extendFlag;
+        return extendScore;
+    }
+    return openScore;
+}
+
+// Traceback cell shared by the aligners, as read back from a TracebackMatrix
+struct Cell {
+    char direction;       // 'D': diagonal, 'U': up, 'L': left, '0': start / origin
+    unsigned char flags;  // EXTEND_UP / EXTEND_LEFT for the affine gap states
+};
+
+// Traceback directions of a DP matrix, 4 bits per cell: the direction in the
+// low two bits and the gap flags above them. Scores are never stored, the
+// fills keep them in rolling rows. The cells live in one 64-byte aligned
+// allocation, row after row, each row padded to a whole number of cache
+// lines, so a traceback walks plain offsets instead of one heap block per
+// row and threads filling different rows never share a line.
+class TracebackMatrix {
+private:
+    struct alignas(64) Line {
+        unsigned char bytes[64];
+    };
+    static const size_t CELLS_PER_LINE = 2 * sizeof(Line);
+
+    std::vector<Line> lines;
+    size_t rowCount = 0, colCount = 0;
+    size_t stride = 0;  // bytes per row
+
+    static unsigned char encode(char direction) {
+        switch (direction) {
+            case 'D': return 1;
+            case 'U': return 2;
+            case 'L': return 3;
+            default: return 0;
+        }
+    }
+
+    unsigned char* bytes() { return lines.empty() ? nullptr : lines[0].bytes; }
+    const unsigned char* bytes() const { return lines.empty() ? nullptr : lines[0].bytes; }
+
+public:
+    // Bytes taken by (rows + 1) x (cols + 1) cells
+    static size_t bytesFor(size_t rows, size_t cols) {
+        return (rows + 1) * ((cols + CELLS_PER_LINE) / CELLS_PER_LINE) * sizeof(Line);
+    }
+
+    // (rows + 1) x (cols + 1) cells, all '0'; the allocation is reused when
+    // it is large enough
+    void reset(size_t rows, size_t cols) {
+        rowCount = rows;
+        colCount = cols;
+        size_t linesPerRow = (cols + CELLS_PER_LINE) / CELLS_PER_LINE;
+        stride = linesPerRow * sizeof(Line);
+        lines.assign((rows + 1) * linesPerRow, Line());
+    }
+
+    void clear() {
+        lines.clear();
+        lines.shrink_to_fit();
+        rowCount = colCount = stride = 0;
+    }
+
+    size_t rows() const { return rowCount; }
+    size_t cols() const { return colCount; }
+    bool empty() const { return lines.empty(); }
+    size_t memoryUsage() const { return lines.capacity() * sizeof(Line); }
+
+    // Store cell (i, j). Cells of different rows may be set concurrently.
+    void set(size_t i, size_t j, char direction, unsigned char flags = 0) {
+        unsigned char& byte = bytes()[i * stride + j / 2];
+        unsigned shift = (j & 1) * 4;
+        unsigned char nibble = static_cast<unsigned char>(encode(direction) | (flags << 2));
+        byte = static_cast<unsigned char>((byte & ~(0xF << shift)) | (nibble << shift));
+    }
+
+    Cell operator()(size_t i, size_t j) const {
+        unsigned nibble = (bytes()[i * stride + j / 2] >> ((j & 1) * 4)) & 0xF;
+        return Cell{"0DUL"[nibble & 3], static_cast<unsigned char>(nibble >> 2)};
+    }
+};
+
+// Wall-clock seconds the last align() call spent in each phase
+struct PhaseTimings {
+    double scan = 0;       // locating the alignment before the fill (striped SW score pass)
+    double fill = 0;       // DP fill of the traceback matrix, block or band
+    double traceback = 0;
+    size_t fillCells = 0;  // cells computed by the fill
+};
+
+using PhaseClock = std::chrono::steady_clock;
+
+inline double secondsSince(PhaseClock::time_point start) {
+    return std::chrono::duration<double>(PhaseClock::now() - start).count();
+}
+
+// Parse --gap-open / --gap-extend style options; returns true if argv[i] was one
+inline bool parseScoringOption(int argc, char* argv[], int& i, ScoringScheme& scoring) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) return false;
+    if (arg == "--gap-open") {
+        scoring.gapOpen = static_cast<int>(std::strtol(argv[++i], nullptr, 10));
+    } else if (arg == "--gap-extend") {
+        scoring.gapExtend = static_cast<int>(std::strtol(argv[++i], nullptr, 10));
+    } else {
+        return false;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,459 @@
+#ifndef NEEDLEMAN_WUNSCH_HPP
+#define NEEDLEMAN_WUNSCH_HPP
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "../dna_sequence.hpp"
+#include "../alignment_scoring.hpp"
+#include "../alignment_cigar.hpp"
+#include "../alignment_wavefront.hpp"
+
+// Full-matrix alignments above this many bytes switch to Hirschberg
+const size_t DEFAULT_MEMORY_BUDGET = size_t(1) << 30;  // 1 GiB
+
+// Starting half-width of the adaptive band
+const size_t DEFAULT_BAND_RADIUS = 32;
+
+// How NeedlemanWunsch::align computes the alignment
+enum class AlignmentMode {
+    Auto,        // full matrix, or Hirschberg once the matrix exceeds the memory budget
+    FullMatrix,  // (n+1) x (m+1) traceback matrix
+    Hirschberg,  // linear-space divide and conquer
+    Banded       // only cells within a band around the diagonal, O(n * k)
+};
+
+class NeedlemanWunsch {
+private:
+    DnaSequence seq1, seq2;  // 2-bit packed; blocks unpack their columns of seq2
+    TracebackMatrix matrix;          // full matrix, or the current Hirschberg block
+    ScoringScheme scoring;
+    AlignmentMode mode = AlignmentMode::Auto;
+    size_t memoryBudget = DEFAULT_MEMORY_BUDGET;
+    size_t bandRadius = DEFAULT_BAND_RADIUS;
+    bool adaptiveBand = false;
+    TracebackMatrix band;            // banded mode: row i holds columns i + bandLow ..
+    ptrdiff_t bandLow = 0;           // lowest diagonal j - i in the band
+    size_t bandWidth = 0;            // diagonals per row
+    std::unique_ptr<ThreadPool> fillPool;  // wavefront fill of large full matrices, see setThreads
+    Cigar path;                      // result of the last align()
+    PhaseTimings timings;
+
+    // Read the first record of a FASTA file
+    DnaSequence readFasta(const std::string& filename) {
+        return readFirstDnaSequence(filename);
+    }
+
+    // Pick the cell score and direction: D, then U, then L on ties
+    static char chooseDirection(int matchScore, int deleteScore, int insertScore, int& score) {
+        if (matchScore >= deleteScore && matchScore >= insertScore) {
+            score = matchScore;
+            return 'D';
+        } else if (deleteScore >= insertScore) {
+            score = deleteScore;
+            return 'U';
+        }
+        score = insertScore;
+        return 'L';
+    }
+
+    // Row 0 of a block whose corner is entered in startState: 'H' for a fresh
+    // start, 'U' when a vertical gap is already open (it then only extends).
+    // h holds H scores, e the vertical-gap (E) scores carried to the next row.
+    template <typename OnCell>
+    void startBlock(size_t cols, char startState, std::vector<int>& h, std::vector<int>& e,
+                    OnCell&& onCell) const {
+        h.assign(cols + 1, NEG_INF);
+        e.assign(cols + 1, NEG_INF);
+        if (startState == 'U') e[0] = 0; else h[0] = 0;
+        onCell(0, '0', 0);
+
+        int f = NEG_INF;
+        for (size_t j = 1; j <= cols; ++j) {
+            unsigned char flags = 0;
+            f = gapState(h[j-1] - scoring.gapOpen, f - scoring.gapExtend, EXTEND_LEFT, flags);
+            h[j] = f;
+            onCell(j, 'L', flags);
+        }
+    }
+
+    // Gotoh recurrences for row i of a block whose seq2 columns are given
+    // unpacked: E is updated in place from the previous row, F rolls along
+    // the row. A band computes only columns jFrom..jTo; the cell left of it
+    // is set to NEG_INF, and cells above it must already hold NEG_INF.
+    template <typename OnCell>
+    void advanceRow(size_t i, const std::string& columns, const std::vector<int>& hPrev,
+                    std::vector<int>& e, std::vector<int>& h, OnCell&& onCell,
+                    size_t jFrom = 0, size_t jTo = SIZE_MAX) const {
+        size_t cols = columns.size();
+        jTo = std::min(jTo, cols);
+        char base1 = seq1[i-1];
+        h.resize(cols + 1, NEG_INF);
+
+        // Only a vertical gap reaches the first column
+        unsigned char flags = 0;
+        if (jFrom == 0) {
+            e[0] = gapState(hPrev[0] - scoring.gapOpen, e[0] - scoring.gapExtend, EXTEND_UP, flags);
+            h[0] = e[0];
+            onCell(0, 'U', flags);
+        } else {
+            h[jFrom - 1] = NEG_INF;
+        }
+
+        int f = NEG_INF;
+        for (size_t j = std::max<size_t>(jFrom, 1); j <= jTo; ++j) {
+            flags = 0;
+            e[j] = gapState(hPrev[j] - scoring.gapOpen, e[j] - scoring.gapExtend, EXTEND_UP, flags);
+            f = gapState(h[j-1] - scoring.gapOpen, f - scoring.gapExtend, EXTEND_LEFT, flags);
+            int matchScore = hPrev[j-1] + scoring.substitution(base1, columns[j-1]);
+            char direction = chooseDirection(matchScore, e[j], f, h[j]);
+            onCell(j, direction, flags);
+        }
+    }
+
+    // Fill the block (i0, j0)..(i1, j1) entered in startState into cells.
+    // Row 0 and column 0 are gap runs; the inner cells of large blocks are
+    // filled as a tiled wavefront on fillPool.
+    void fillBlock(size_t i0, size_t j0, size_t i1, size_t j1, char startState,
+                   TracebackMatrix& cells) const {
+        size_t rows = i1 - i0, cols = j1 - j0;
+        cells.reset(rows, cols);
+        GotohEdges edges;
+        std::string columns, rowBases;
+        seq2.decode(j0, cols, columns);
+        seq1.decode(i0, rows, rowBases);
+
+        startBlock(cols, startState, edges.h, edges.e, [&](size_t j, char direction, unsigned char flags) {
+            cells.set(0, j, direction, flags);
+        });
+
+        // Only a vertical gap reaches the first column
+        edges.hLeft.assign(rows + 1, NEG_INF);
+        edges.corner.assign(rows + 1, NEG_INF);
+        edges.hLeft[0] = edges.h[0];
+        int e0 = edges.e[0];
+        for (size_t i = 1; i <= rows; ++i) {
+            unsigned char flags = 0;
+            e0 = gapState(edges.hLeft[i-1] - scoring.gapOpen, e0 - scoring.gapExtend, EXTEND_UP, flags);
+            edges.hLeft[i] = e0;
+            edges.corner[i] = edges.hLeft[i-1];
+            cells.set(i, 0, 'U', flags);
+        }
+
+        edges.f.assign(rows + 1, NEG_INF);
+        bool parallel = fillPool && rows * cols >= WAVEFRONT_MIN_CELLS;
+        runWavefront(parallel ? fillPool.get() : nullptr, rows, cols,
+                     parallel ? WAVEFRONT_TILE : std::max(rows, cols),
+                     [&](size_t a0, size_t a1, size_t b0, size_t b1) {
+            fillGotohTile<false>(cells, rowBases, columns, scoring, edges, a0, a1, b0, b1);
+        });
+    }
+
+    // Walk filled cells back from (rows, cols) in endState; cellAt(i, j)
+    // returns the Cell at block offset (i, j), and rowBases / colBases are
+    // the block's bases of seq1 / seq2. The block's path is appended to path.
+    template <typename CellAt>
+    void traceCells(CellAt&& cellAt, const std::string& rowBases, const std::string& colBases, char endState) {
+        Cigar part;
+        size_t i = rowBases.size(), j = colBases.size();
+        char state = endState;
+
+        while (i > 0 || j > 0) {
+            Cell cell = cellAt(i, j);
+            if (state == 'H') {
+                if (cell.direction == 'D' && i > 0 && j > 0) {
+                    part.push(rowBases[i - 1] == colBases[j - 1] ? '=' : 'X');
+                    i--; j--;
+                    continue;
+                }
+                state = (cell.direction == 'U' && i > 0) || j == 0 ? 'U' : 'L';
+            }
+            if (state == 'U' && i == 0) state = 'L';  // gap runs end at the block edge
+            if (state == 'L' && j == 0) state = 'U';
+            if (state == 'U') {
+                part.push('I');
+                state = (cell.flags & EXTEND_UP) ? 'U' : 'H';
+                i--;
+            } else {
+                part.push('D');
+                state = (cell.flags & EXTEND_LEFT) ? 'L' : 'H';
+                j--;
+            }
+        }
+        part.reverse();
+        path.append(part);
+    }
+
+    void traceBlock(const TracebackMatrix& cells, size_t i0, size_t j0, char endState) {
+        std::string rowBases, colBases;
+        seq1.decode(i0, cells.rows(), rowBases);
+        seq2.decode(j0, cells.cols(), colBases);
+        traceCells([&cells](size_t i, size_t j) { return cells(i, j); }, rowBases, colBases, endState);
+    }
+
+    void initializeMatrix() {
+        // Matrix with dimensions (seq1.length + 1) x (seq2.length + 1); the
+        // first row and column are gap runs from the origin; fillBlock sizes it
+        matrix.clear();
+    }
+
+    void fillMatrix() {
+        fillBlock(0, 0, seq1.length(), seq2.length(), 'H', matrix);
+    }
+
+    void traceback() {
+        path.clear();
+        // Start from the bottom-right corner and work back to origin
+        traceBlock(matrix, 0, 0, 'H');
+    }
+
+    // Crossing points of the traceback path with the middle row of a block,
+    // packed as column * 2 + (1 if the path is inside a vertical gap there)
+    static size_t packEntry(size_t column, char state) {
+        return column * 2 + (state == 'U' ? 1 : 0);
+    }
+
+    // Where the traceback from (i1, j1) in endState first reaches row mid.
+    // Every cell state of rows mid+1..i1 remembers where its own traceback
+    // path enters row mid, so the split lies on the same path traceBlock()
+    // follows, gap state included.
+    size_t findCrossing(size_t i0, size_t j0, char startState, size_t i1, size_t j1,
+                        char endState, size_t mid) const {
+        size_t cols = j1 - j0;
+        std::vector<int> hPrev, h, e;
+        std::string columns;
+        seq2.decode(j0, cols, columns);
+        startBlock(cols, startState, hPrev, e, [](size_t, char, unsigned char) {});
+        for (size_t i = i0 + 1; i <= mid; ++i) {
+            advanceRow(i, columns, hPrev, e, h, [](size_t, char, unsigned char) {});
+            hPrev.swap(h);
+        }
+
+        std::vector<size_t> entryPrev(cols + 1), entry(cols + 1), entryE(cols + 1);
+        size_t entryF = 0;
+        for (size_t i = mid + 1; i <= i1; ++i) {
+            bool fromMid = (i - 1 == mid);
+            advanceRow(i, columns, hPrev, e, h, [&](size_t j, char direction, unsigned char flags) {
+                size_t column = j0 + j;
+                if (flags & EXTEND_UP) {
+                    entryE[j] = fromMid ? packEntry(column, 'U') : entryE[j];
+                } else {
+                    entryE[j] = fromMid ? packEntry(column, 'H') : entryPrev[j];
+                }
+                if (j == 0) {
+                    entry[0] = entryE[0];
+                    return;
+                }
+                if (!(flags & EXTEND_LEFT)) entryF = entry[j-1];
+                if (direction == 'D') {
+                    entry[j] = fromMid ? packEntry(column - 1, 'H') : entryPrev[j-1];
+                } else if (direction == 'U') {
+                    entry[j] = entryE[j];
+                } else {
+                    entry[j] = entryF;
+                }
+            });
+            hPrev.swap(h);
+            entryPrev.swap(entry);
+        }
+        return endState == 'U' ? entryE[cols] : entryPrev[cols];
+    }
+
+    // Full-matrix alignment of a block, appended to the output; the blocks
+    // share the matrix storage
+    void alignBlock(size_t i0, size_t j0, char startState, size_t i1, size_t j1, char endState) {
+        fillBlock(i0, j0, i1, j1, startState, matrix);
+        traceBlock(matrix, i0, j0, endState);
+    }
+
+    // Hirschberg divide and conquer over the block (i0, j0)..(i1, j1). The
+    // corner states carry a vertical gap that runs through a split row.
+    void hirschberg(size_t i0, size_t j0, char startState, size_t i1, size_t j1, char endState) {
+        const size_t BLOCK_CELLS = 1 << 16;  // small enough to solve directly
+        if (i1 - i0 <= 1 || (i1 - i0 + 1) * (j1 - j0 + 1) <= BLOCK_CELLS) {
+            alignBlock(i0, j0, startState, i1, j1, endState);
+            return;
+        }
+
+        // Both corners are on the traceback path, so each half reproduces it
+        size_t mid = i0 + (i1 - i0) / 2;
+        size_t split = findCrossing(i0, j0, startState, i1, j1, endState, mid);
+        size_t column = split / 2;
+        char state = (split & 1) ? 'U' : 'H';
+        hirschberg(i0, j0, startState, mid, column, state);
+        hirschberg(mid, column, state, i1, j1, endState);
+    }
+
+    // Gotoh fill of the cells with bandLow <= j - i < bandLow + bandWidth:
+    // radius diagonals beyond the ones joining the corners. Returns the score.
+    int fillBand(size_t radius) {
+        size_t n = seq1.length(), m = seq2.length();
+        ptrdiff_t lengthDiff = static_cast<ptrdiff_t>(m) - static_cast<ptrdiff_t>(n);
+        ptrdiff_t reach = static_cast<ptrdiff_t>(std::min(radius, n + m));
+        ptrdiff_t high = std::max<ptrdiff_t>(0, lengthDiff) + reach;
+        bandLow = std::min<ptrdiff_t>(0, lengthDiff) - reach;
+        bandWidth = static_cast<size_t>(high - bandLow + 1);
+        band.reset(n, bandWidth - 1);
+        timings.fillCells += (n + 1) * bandWidth;
+
+        std::string columns;
+        seq2.decode(0, m, columns);
+        std::vector<int> hPrev, h, e;
+        startBlock(m, 'H', hPrev, e, [&](size_t j, char direction, unsigned char flags) {
+            if (static_cast<ptrdiff_t>(j) <= high) band.set(0, j - bandLow, direction, flags);
+        });
+        for (size_t j = static_cast<size_t>(high + 1); j <= m; ++j) {
+            hPrev[j] = NEG_INF;  // outside the band
+        }
+        h.assign(m + 1, NEG_INF);
+
+        for (size_t i = 1; i <= n; ++i) {
+            ptrdiff_t first = static_cast<ptrdiff_t>(i) + bandLow;
+            size_t jFrom = static_cast<size_t>(std::max<ptrdiff_t>(first, 0));
+            size_t jTo = static_cast<size_t>(std::min<ptrdiff_t>(static_cast<ptrdiff_t>(i) + high, m));
+            advanceRow(i, columns, hPrev, e, h, [&](size_t j, char direction, unsigned char flags) {
+                band.set(i, static_cast<size_t>(static_cast<ptrdiff_t>(j) - first), direction, flags);
+            }, jFrom, jTo);
+            hPrev.swap(h);
+        }
+        return hPrev[m];
+    }
+
+    // True when no global path leaving the band can reach score, so the
+    // banded result is the full-DP result, traceback included. A path that
+    // steps outside needs a minimum number of gap positions; even if every
+    // other column were a match it would score below the band's optimum.
+    bool bandIsExact(int score) const {
+        long long n = seq1.length(), m = seq2.length();
+        long long low = bandLow, high = bandLow + static_cast<long long>(bandWidth) - 1;
+        long long gaps = -1;
+        if (high + 1 <= m) gaps = 2 * (high + 1) - (m - n);
+        if (1 - low <= n) {
+            long long lowGaps = 2 * (1 - low) + (m - n);
+            gaps = gaps < 0 ? lowGaps : std::min(gaps, lowGaps);
+        }
+        if (gaps < 0) return true;  // the band covers the whole matrix
+
+        long long pairs = (n + m - gaps) / 2;
+        long long best = pairs * std::max(scoring.match, scoring.mismatch) -
+                         (scoring.gapOpen + (gaps - 1) * scoring.gapExtend);
+        return best < score;
+    }
+
+    // Banded alignment; the adaptive variant doubles the radius until the
+    // band provably holds the optimal path
+    void alignBanded() {
+        PhaseClock::time_point start = PhaseClock::now();
+        size_t radius = bandRadius;
+        int score = fillBand(radius);
+        while (adaptiveBand && !bandIsExact(score)) {
+            radius = std::max<size_t>(radius * 2, 1);
+            score = fillBand(radius);
+        }
+        timings.fill = secondsSince(start);
+
+        start = PhaseClock::now();
+        path.clear();
+        std::string rowBases = seq1.str(), colBases = seq2.str();
+        traceCells([this](size_t i, size_t j) {
+            ptrdiff_t diagonal = static_cast<ptrdiff_t>(j) - static_cast<ptrdiff_t>(i);
+            return band(i, static_cast<size_t>(diagonal - bandLow));
+        }, rowBases, colBases, 'H');
+        band.clear();
+        timings.traceback = secondsSince(start);
+    }
+
+    // Memory the (n+1) x (m+1) traceback matrix would take
+    size_t fullMatrixBytes() const {
+        return TracebackMatrix::bytesFor(seq1.length(), seq2.length());
+    }
+
+public:
+    // Aligner without sequences, filled in later through setSequences
+    NeedlemanWunsch() = default;
+
+    NeedlemanWunsch(const std::string& file1, const std::string& file2) {
+        seq1 = readFasta(file1);
+        seq2 = readFasta(file2);
+    }
+
+    void setSequences(const DnaSequence& first, const DnaSequence& second) {
+        seq1 = first;
+        seq2 = second;
+    }
+
+    void setMode(AlignmentMode newMode) { mode = newMode; }
+
+    // Threads for filling large full matrices (0 = all cores, 1 = the
+    // calling thread only); the alignment is the same for any count
+    void setThreads(size_t threads) {
+        if (threads == 0) threads = ThreadPool::defaultThreadCount();
+        fillPool = threads > 1 ? std::make_unique<ThreadPool>(threads) : nullptr;
+    }
+    void setMemoryBudget(size_t bytes) { memoryBudget = bytes; }
+
+    // Half-width of the band in Banded mode, beyond the |n - m| diagonals
+    // between the corners. Adaptive bands grow until the result is exact;
+    // fixed ones may miss paths that leave the band.
+    void setBand(size_t radius, bool adaptive) {
+        bandRadius = radius;
+        adaptiveBand = adaptive;
+    }
+
+    // Substitution scores and affine gap costs
+    void setScoring(const ScoringScheme& newScoring) {
+        newScoring.validate();
+        scoring = newScoring;
+    }
+
+    // Whether align() will use the linear-space path
+    bool usesHirschberg() const {
+        return mode == AlignmentMode::Hirschberg ||
+               (mode == AlignmentMode::Auto && fullMatrixBytes() > memoryBudget);
+    }
+
+    void align() {
+        timings = PhaseTimings();
+        if (mode == AlignmentMode::Banded) {
+            matrix.clear();
+            alignBanded();
+            return;
+        }
+
+        PhaseClock::time_point start = PhaseClock::now();
+        if (usesHirschberg()) {
+            // O(n + m) memory, same aligned strings as traceback(). Fill and
+            // traceback interleave, so all of it is counted as fill.
+            matrix.clear();
+            path.clear();
+            hirschberg(0, 0, 'H', seq1.length(), seq2.length(), 'H');
+            timings.fill = secondsSince(start);
+            timings.fillCells = seq1.length() * seq2.length();
+            return;
+        }
+        initializeMatrix();
+        fillMatrix();
+        timings.fill = secondsSince(start);
+        timings.fillCells = (seq1.length() + 1) * (seq2.length() + 1);
+
+        start = PhaseClock::now();
+        traceback();
+        timings.traceback = secondsSince(start);
+    }
+
+    // Path of the last alignment, seq1 as the query
+    const Cigar& cigar() const { return path; }
+
+    // Gapped rows of the last alignment, built from the CIGAR
+    void alignedStrings(std::string& aligned1, std::string& aligned2) const {
+        path.render(seq1.str(), seq2.str(), aligned1, aligned2);
+    }
+
+    // Time spent in each phase of the last align()
+    const PhaseTimings& phaseTimings() const { return timings; }
+};
+
+#endif
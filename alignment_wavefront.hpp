@@ -0,0 +1,180 @@
+#ifndef ALIGNMENT_WAVEFRONT_HPP
+#define ALIGNMENT_WAVEFRONT_HPP
+
+#include <string>
+#include <vector>
+#include <future>
+#include <exception>
+#include <algorithm>
+#include <cstddef>
+#include "alignment_scoring.hpp"
+#include "thread_pool.hpp"
+
+// Multi-core fill of one large DP matrix. The matrix is cut into square
+// tiles; a tile needs only the tiles above, to the left and above-left of
+// it, so every tile on one anti-diagonal of tiles can be filled at the same
+// time. The fill runs diagonal by diagonal on a thread pool: the first and
+// last diagonals are short, the middle ones give every thread a tile.
+//
+// Scores are not kept in the matrix, which only stores traceback bits.
+// Tiles exchange their edges through GotohEdges: per column the H and E
+// scores of the last row filled above, per row the H and F scores of the
+// last column filled to the left. Only the tiles of one tile column touch a
+// column's entries, in top-to-bottom order, and likewise for a row's, so
+// none of them needs locking. Every cell sees the same inputs as in a
+// row-by-row fill, so results are identical.
+
+const size_t WAVEFRONT_TILE = 256;                 // cells per tile edge: a tile's rows stay in L2
+const size_t WAVEFRONT_MIN_CELLS = size_t(1) << 22;  // smaller fills stay on the calling thread
+
+// Call tile(i0, i1, j0, j1) for the tiles covering cells [1, rows] x [1, cols],
+// each after the tiles above and to its left; rows [i0, i1), columns [j0, j1).
+// Tiles of one anti-diagonal run on pool, or in order on the calling thread
+// when pool is null.
+template <typename Tile>
+void runWavefront(ThreadPool* pool, size_t rows, size_t cols, size_t tileSize, Tile&& tile) {
+    if (rows == 0 || cols == 0) return;
+    size_t tileRows = (rows + tileSize - 1) / tileSize;
+    size_t tileCols = (cols + tileSize - 1) / tileSize;
+
+    std::vector<std::future<void> > running;
+    for (size_t diagonal = 0; diagonal + 1 < tileRows + tileCols; ++diagonal) {
+        size_t firstRow = diagonal >= tileCols ? diagonal - tileCols + 1 : 0;
+        size_t lastRow = std::min(diagonal, tileRows - 1);
+        for (size_t ti = firstRow; ti <= lastRow; ++ti) {
+            size_t tj = diagonal - ti;
+            size_t i0 = 1 + ti * tileSize, i1 = std::min(rows + 1, i0 + tileSize);
+            size_t j0 = 1 + tj * tileSize, j1 = std::min(cols + 1, j0 + tileSize);
+            if (pool == nullptr) {
+                tile(i0, i1, j0, j1);
+            } else {
+                running.push_back(pool->submit([&tile, i0, i1, j0, j1] { tile(i0, i1, j0, j1); }));
+            }
+        }
+
+        // Wait for the whole diagonal, even after a failure: later tiles
+        // would read cells the failed one never wrote
+        std::exception_ptr error;
+        for (std::future<void>& task : running) {
+            try {
+                task.get();
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+        }
+        running.clear();
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+// Highest-scoring cell of a local fill; ties go to the first cell in
+// row-major order, as in a row-by-row scan
+struct LocalBest {
+    int score = 0;
+    size_t i = 0, j = 0;
+
+    void merge(const LocalBest& other) {
+        if (other.score > score ||
+            (other.score == score && score > 0 && (other.i < i || (other.i == i && other.j < j)))) {
+            *this = other;
+        }
+    }
+};
+
+// Score edges shared by the tiles of one fill (see above). corner[i] is the
+// H score diagonally above-left of the first cell of the next tile that
+// starts in row i. Before the fill, h/e hold row 0, hLeft column 0, f
+// NEG_INF and corner[i] the H score of cell (i - 1, 0).
+struct GotohEdges {
+    std::vector<int> h, e;              // by column
+    std::vector<int> hLeft, f, corner;  // by row
+};
+
+// Gap costs of a fill: a vertical gap through row i costs openUp(i) to
+// open and extendUp(i) to extend, a horizontal one through column j
+// openLeft(j) and extendLeft(j). Base alignments use the same costs
+// everywhere; profiles make them position specific.
+struct UniformGapCosts {
+    int open, extend;
+
+    explicit UniformGapCosts(const ScoringScheme& scoring) : open(scoring.gapOpen), extend(scoring.gapExtend) {}
+
+    int openUp(size_t) const { return open; }
+    int extendUp(size_t) const { return extend; }
+    int openLeft(size_t) const { return open; }
+    int extendLeft(size_t) const { return extend; }
+};
+
+// Gotoh fill of cells [i0, i1) x [j0, j1) into trace. substitution(i, j)
+// scores row i against column j and gaps prices gap runs (see UniformGapCosts).
+// Local fills floor scores at zero ('0' cells) and report their best cell.
+template <bool Local, typename Substitution, typename GapCosts>
+LocalBest fillGotohTile(TracebackMatrix& trace, Substitution&& substitution, const GapCosts& gaps,
+                        GotohEdges& edges, size_t i0, size_t i1, size_t j0, size_t j1) {
+    LocalBest best;
+    int* h = edges.h.data();
+    int* e = edges.e.data();
+    int diag = edges.corner[i0];
+    edges.corner[i0] = h[j1 - 1];  // for the tile to the right
+    for (size_t i = i0; i < i1; ++i) {
+        int left = edges.hLeft[i];
+        int nextDiag = left;  // H(i, j0 - 1), diagonal input of the next row
+        int fi = edges.f[i];
+        const int openUp = gaps.openUp(i), extendUp = gaps.extendUp(i);
+        for (size_t j = j0; j < j1; ++j) {
+            int up = h[j];
+            int match = diag + substitution(i, j);
+
+            unsigned char flags = 0;
+            int del = e[j] = gapState(up - openUp, e[j] - extendUp, EXTEND_UP, flags);
+            int ins = fi = gapState(left - gaps.openLeft(j), fi - gaps.extendLeft(j), EXTEND_LEFT, flags);
+
+            int score;
+            if (Local) {
+                score = std::max(0, std::max(match, std::max(del, ins)));
+                if (score == 0) {
+                    trace.set(i, j, '0');
+                } else if (score == match) {
+                    trace.set(i, j, 'D', flags);
+                } else if (score == del) {
+                    trace.set(i, j, 'U', flags);
+                } else {
+                    trace.set(i, j, 'L', flags);
+                }
+                if (score > best.score) {
+                    best.score = score;
+                    best.i = i;
+                    best.j = j;
+                }
+            } else if (match >= del && match >= ins) {  // D, then U, then L on ties
+                score = match;
+                trace.set(i, j, 'D', flags);
+            } else if (del >= ins) {
+                score = del;
+                trace.set(i, j, 'U', flags);
+            } else {
+                score = ins;
+                trace.set(i, j, 'L', flags);
+            }
+            diag = up;
+            h[j] = left = score;
+        }
+        edges.hLeft[i] = left;
+        edges.f[i] = fi;
+        diag = nextDiag;
+    }
+    return best;
+}
+
+// Base-against-base fill: rowBases[i - 1] and colBases[j - 1] are the bases
+// of row i and column j
+template <bool Local>
+LocalBest fillGotohTile(TracebackMatrix& trace, const std::string& rowBases,
+                        const std::string& colBases, const ScoringScheme& scoring,
+                        GotohEdges& edges, size_t i0, size_t i1, size_t j0, size_t j1) {
+    return fillGotohTile<Local>(trace, [&](size_t i, size_t j) {
+        return scoring.substitution(rowBases[i - 1], colBases[j - 1]);
+    }, UniformGapCosts(scoring), edges, i0, i1, j0, j1);
+}
+
+#endif
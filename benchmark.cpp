@@ -0,0 +1,507 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include "fasta_reader.hpp"
+#include "gc_counter.hpp"
+#include "gc_pipeline.hpp"
+#include "dna_sequence.hpp"
+#include "smith_waterman.hpp"
+#include "edit_distance.hpp"
+#include "alignment_visualization/needleman_wunsch.hpp"
+
+// Benchmark harness for the GC counters and the aligners. Synthetic FASTA
+// inputs are generated with a fixed seed, every benchmark runs a few warmup
+// repetitions and then the timed ones, and one line per benchmark is written
+// as TSV or JSON so results can be compared between commits.
+
+struct BenchmarkOptions {
+    size_t gcBases = 64 << 20;       // total bases of the GC input
+    size_t records = 4;
+    double gcFraction = 0.41;
+    size_t lineWidth = 60;
+    size_t alignLength = 2000;       // length of each alignment input
+    double divergence = 0.05;        // mutation rate of the second alignment input
+    size_t warmup = 1;
+    size_t reps = 10;
+    size_t threads = 0;              // 0 = all cores
+    uint64_t seed = 42;
+    std::string dir = ".";
+    std::string only;                // run benchmarks whose name starts with this
+    std::vector<std::string> binaries;  // external GC programs to time
+    bool json = false;
+    bool keep = false;
+};
+
+// xorshift64* generator, so inputs are identical across runs and platforms
+class SyntheticGenerator {
+private:
+    uint64_t state;
+
+public:
+    explicit SyntheticGenerator(uint64_t seed) : state(seed == 0 ? 0x9E3779B97F4A7C15ULL : seed) {}
+
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    }
+
+    // Uniform in [0, 1)
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+    // G or C with probability gcFraction, A or T otherwise
+    char base(double gcFraction) {
+        uint64_t r = next();
+        bool gc = (r >> 11) * (1.0 / 9007199254740992.0) < gcFraction;
+        return gc ? "GC"[r & 1] : "AT"[r & 1];
+    }
+
+    std::string sequence(size_t length, double gcFraction) {
+        std::string bases(length, 'A');
+        for (char& b : bases) b = base(gcFraction);
+        return bases;
+    }
+
+    // Copy of bases with substitutions, insertions and deletions, each a third
+    // of the given per-base rate
+    std::string mutate(const std::string& bases, double rate, double gcFraction) {
+        std::string out;
+        out.reserve(bases.size() + bases.size() / 8);
+        for (char b : bases) {
+            if (uniform() >= rate) {
+                out += b;
+                continue;
+            }
+            switch (next() % 3) {
+                case 0: {
+                    char substitute;
+                    do { substitute = base(gcFraction); } while (substitute == b);
+                    out += substitute;
+                    break;
+                }
+                case 1:
+                    out += b;
+                    out += base(gcFraction);
+                    break;
+                default:
+                    break;  // deletion
+            }
+        }
+        return out;
+    }
+};
+
+void writeFastaRecord(std::ostream& out, const std::string& name, const std::string& bases, size_t lineWidth) {
+    out << '>' << name << '\n';
+    for (size_t i = 0; i < bases.size(); i += lineWidth) {
+        out.write(bases.data() + i, std::min(lineWidth, bases.size() - i));
+        out << '\n';
+    }
+}
+
+// records FASTA records of bases / records bases each
+void writeSyntheticGCFile(const std::string& path, const BenchmarkOptions& options, SyntheticGenerator& rng) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    size_t records = std::max<size_t>(options.records, 1);
+    for (size_t r = 0; r < records; ++r) {
+        size_t length = options.gcBases / records + (r < options.gcBases % records ? 1 : 0);
+        writeFastaRecord(out, "synthetic_" + std::to_string(r + 1), rng.sequence(length, options.gcFraction),
+                         options.lineWidth);
+    }
+    if (!out) {
+        throw std::runtime_error("Cannot write file: " + path);
+    }
+}
+
+void writeSingleRecord(const std::string& path, const std::string& name, const std::string& bases, size_t lineWidth) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    writeFastaRecord(out, name, bases, lineWidth);
+}
+
+// Timings of one benchmark; work is the amount done per repetition
+struct BenchmarkResult {
+    std::string name;
+    std::string unit;   // "bases", "cells" or "columns"
+    double work = 0;
+    std::vector<double> seconds;
+
+    // Nearest-rank percentile of the repetition times
+    double percentile(double p) const {
+        std::vector<double> sorted = seconds;
+        std::sort(sorted.begin(), sorted.end());
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+        return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+    }
+
+    double mean() const {
+        double total = 0;
+        for (double s : seconds) total += s;
+        return total / seconds.size();
+    }
+
+    // Throughput at the median time; cell rates in GCUPS
+    double throughput() const {
+        double rate = work / percentile(50);
+        return unit == "cells" ? rate / 1e9 : rate;
+    }
+
+    std::string throughputUnit() const {
+        return unit == "cells" ? "GCUPS" : unit + "/s";
+    }
+};
+
+class BenchmarkReport {
+private:
+    std::ostream& out;
+    bool json;
+
+    static std::string jsonString(const std::string& text) {
+        std::string quoted = "\"";
+        for (char c : text) {
+            if (c == '"' || c == '\\') quoted += '\\';
+            quoted += c;
+        }
+        return quoted + '"';
+    }
+
+public:
+    BenchmarkReport(std::ostream& stream, bool asJson) : out(stream), json(asJson) {}
+
+    // Run parameters, as '#' comment lines in TSV or one JSON "config" line
+    void header(const BenchmarkOptions& options, size_t threads) {
+        std::vector<std::pair<std::string, std::string>> config = {
+            {"gc_bases", std::to_string(options.gcBases)},
+            {"records", std::to_string(options.records)},
+            {"gc_fraction", std::to_string(options.gcFraction)},
+            {"align_length", std::to_string(options.alignLength)},
+            {"divergence", std::to_string(options.divergence)},
+            {"warmup", std::to_string(options.warmup)},
+            {"reps", std::to_string(options.reps)},
+            {"threads", std::to_string(threads)},
+            {"seed", std::to_string(options.seed)},
+            {"gc_kernel", gcKernelName(bestGCKernel())},
+            {"striped_kernel", stripedKernelName(bestStripedKernel())},
+        };
+        if (json) {
+            out << "{\"type\":\"config\"";
+            for (const auto& entry : config) out << ',' << jsonString(entry.first) << ':' << jsonString(entry.second);
+            out << "}\n";
+        } else {
+            for (const auto& entry : config) out << "# " << entry.first << '=' << entry.second << '\n';
+            out << "name\twork\tunit\treps\tmin_s\tp50_s\tp90_s\tp99_s\tmax_s\tmean_s\tthroughput\tthroughput_unit\n";
+        }
+        out.flush();
+    }
+
+    void add(const BenchmarkResult& result) {
+        if (result.seconds.empty()) return;
+        out << std::setprecision(6);
+        if (json) {
+            out << "{\"type\":\"result\",\"name\":" << jsonString(result.name)
+                << ",\"work\":" << std::fixed << std::setprecision(0) << result.work << std::defaultfloat
+                << std::setprecision(6) << ",\"unit\":" << jsonString(result.unit)
+                << ",\"reps\":" << result.seconds.size()
+                << ",\"min_s\":" << result.percentile(0) << ",\"p50_s\":" << result.percentile(50)
+                << ",\"p90_s\":" << result.percentile(90) << ",\"p99_s\":" << result.percentile(99)
+                << ",\"max_s\":" << result.percentile(100) << ",\"mean_s\":" << result.mean()
+                << ",\"throughput\":" << result.throughput()
+                << ",\"throughput_unit\":" << jsonString(result.throughputUnit()) << "}\n";
+        } else {
+            out << result.name << '\t' << std::fixed << std::setprecision(0) << result.work << std::defaultfloat
+                << std::setprecision(6) << '\t' << result.unit << '\t' << result.seconds.size()
+                << '\t' << result.percentile(0) << '\t' << result.percentile(50)
+                << '\t' << result.percentile(90) << '\t' << result.percentile(99)
+                << '\t' << result.percentile(100) << '\t' << result.mean()
+                << '\t' << result.throughput() << '\t' << result.throughputUnit() << '\n';
+        }
+        out.flush();
+    }
+};
+
+// Keeps the results of timed work observable so it is not optimized away
+volatile uint64_t benchmarkSink = 0;
+
+class BenchmarkRunner {
+private:
+    const BenchmarkOptions& options;
+    BenchmarkReport& report;
+
+public:
+    BenchmarkRunner(const BenchmarkOptions& opts, BenchmarkReport& out) : options(opts), report(out) {}
+
+    bool selected(const std::string& name) const {
+        return name.compare(0, options.only.size(), options.only) == 0;
+    }
+
+    // Time fn as a whole, warmup runs discarded
+    void time(const std::string& name, const std::string& unit, double work, const std::function<void()>& fn) {
+        if (!selected(name)) return;
+        BenchmarkResult result{name, unit, work, {}};
+        for (size_t r = 0; r < options.warmup; ++r) fn();
+        for (size_t r = 0; r < options.reps; ++r) {
+            PhaseClock::time_point start = PhaseClock::now();
+            fn();
+            result.seconds.push_back(secondsSince(start));
+        }
+        report.add(result);
+    }
+
+    // Run align() repeatedly and report the scan, fill and traceback phases
+    // separately from the aligner's own phase timings; phases an aligner does
+    // not time on their own are left out
+    template <typename Aligner, typename AlignedLength>
+    void phases(const std::string& prefix, Aligner& aligner, AlignedLength alignedLength, double scanCells) {
+        if (!selected(prefix)) return;
+        BenchmarkResult scan{prefix + "/scan", "cells", scanCells, {}};
+        BenchmarkResult fill{prefix + "/fill", "cells", 0, {}};
+        BenchmarkResult traceback{prefix + "/traceback", "columns", 0, {}};
+        for (size_t r = 0; r < options.warmup; ++r) aligner.align();
+        for (size_t r = 0; r < options.reps; ++r) {
+            aligner.align();
+            const PhaseTimings& timings = aligner.phaseTimings();
+            if (timings.scan > 0) scan.seconds.push_back(timings.scan);
+            fill.seconds.push_back(timings.fill);
+            if (timings.traceback > 0) traceback.seconds.push_back(timings.traceback);  // Hirschberg: part of fill
+            fill.work = static_cast<double>(timings.fillCells);
+            traceback.work = static_cast<double>(alignedLength());
+        }
+        report.add(scan);
+        report.add(fill);
+        report.add(traceback);
+    }
+};
+
+// main_cpu's serial path: walk the mapped records and count each body
+GCCounts serialGC(const std::string& filename, GCCountFunction kernel) {
+    FastaReader reader(filename);
+    FastaRecord record;
+    GCCounts total;
+    while (reader.next(record)) {
+        if (!record.empty()) total += kernel(record.body.data(), record.body.size());
+    }
+    return total;
+}
+
+std::string shellQuote(const std::string& text) {
+    std::string quoted = "'";
+    for (char c : text) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return quoted + "'";
+}
+
+void runBenchmarks(const BenchmarkOptions& options, std::ostream& out) {
+    SyntheticGenerator rng(options.seed);
+    const std::string gcFile = options.dir + "/bench_gc.fa";
+    const std::string queryFile = options.dir + "/bench_query.fa";
+    const std::string targetFile = options.dir + "/bench_target.fa";
+
+    writeSyntheticGCFile(gcFile, options, rng);
+    std::string query = rng.sequence(options.alignLength, options.gcFraction);
+    std::string target = rng.mutate(query, options.divergence, options.gcFraction);
+    writeSingleRecord(queryFile, "query", query, options.lineWidth);
+    writeSingleRecord(targetFile, "target", target, options.lineWidth);
+
+    BenchmarkReport report(out, options.json);
+    size_t threads = options.threads == 0 ? ThreadPool::defaultThreadCount() : options.threads;
+    report.header(options, threads);
+    BenchmarkRunner runner(options, report);
+
+    // GC content: every kernel the CPU supports over the raw record bodies,
+    // then the end-to-end serial and parallel paths of main_cpu
+    const double bases = static_cast<double>(options.gcBases);
+    {
+        FastaReader reader(gcFile);
+        std::vector<FastaRecord> records;
+        FastaRecord record;
+        while (reader.next(record)) records.push_back(record);
+
+        const GCKernel kernels[] = {GCKernel::Scalar, GCKernel::SSE42, GCKernel::AVX2, GCKernel::AVX512};
+        for (GCKernel kernel : kernels) {
+            if (!gcKernelSupported(kernel)) continue;
+            GCCountFunction count = gcKernelFunction(kernel);
+            runner.time(std::string("gc/kernel/") + gcKernelName(kernel), "bases", bases, [&] {
+                for (const FastaRecord& r : records) benchmarkSink = benchmarkSink + count(r.body.data(), r.body.size()).gc;
+            });
+        }
+
+        runner.time("gc/serial", "bases", bases, [&] {
+            benchmarkSink = benchmarkSink + serialGC(gcFile, gcKernelFunction(bestGCKernel())).gc;
+        });
+
+        if (runner.selected("gc/parallel")) {
+            ParallelGCCounter counter(threads);
+            runner.time("gc/parallel", "bases", bases, [&] {
+                FastaReader parallelReader(gcFile);
+                counter.run(parallelReader,
+                    [](const FastaRecord&, const GCCounts& counts) { benchmarkSink = benchmarkSink + counts.gc; },
+                    [] { return false; });
+            });
+        }
+
+        DnaSequence packed;
+        runner.time("gc/pack", "bases", bases, [&] {
+            packed = DnaSequence();
+            for (const FastaRecord& r : records) packed.appendRecord(r);
+        });
+        if (packed.empty()) {
+            for (const FastaRecord& r : records) packed.appendRecord(r);
+        }
+        runner.time("gc/packed-popcount", "bases", bases, [&] {
+            benchmarkSink = benchmarkSink + packed.gcCounts().gc;
+        });
+    }
+
+    // External programs (./gc_content for the OpenCL path of main.cpp,
+    // main_cpu, ...) timed end to end on the same input
+    for (const std::string& binary : options.binaries) {
+        std::string name = binary.substr(binary.find_last_of('/') + 1);
+        std::string command = shellQuote(binary) + " " + shellQuote(gcFile) + " > /dev/null";
+        runner.time("exec/" + name, "bases", bases, [&] {
+            if (std::system(command.c_str()) != 0) {
+                throw std::runtime_error("Command failed: " + command);
+            }
+        });
+    }
+
+    // Alignment phases
+    const double pairCells = static_cast<double>(query.size()) * target.size();
+    DnaSequence first(query), second(target);
+    {
+        SmithWaterman sw;
+        sw.setSequences(first, second);
+        sw.setStriped(true);
+        runner.phases("sw/striped", sw, [&] { return sw.summary().length; }, pairCells);
+        sw.setStriped(false);
+        runner.phases("sw/scalar", sw, [&] { return sw.summary().length; }, pairCells);
+        if (runner.selected("sw/scalar-wavefront")) {
+            sw.setThreads(threads);
+            runner.phases("sw/scalar-wavefront", sw, [&] { return sw.summary().length; }, pairCells);
+        }
+    }
+
+    // Bit-vector edit distance, the batch prefilter: unbounded, and bounded
+    // by the expected number of edits where Ukkonen's cut-off applies
+    {
+        MyersMatcher matcher(query);
+        int expected = static_cast<int>(options.divergence * query.size()) + 1;
+        runner.time("ed/myers-global", "cells", pairCells, [&] {
+            benchmarkSink = benchmarkSink + matcher.search(target, EditMode::Global).distance;
+        });
+        runner.time("ed/myers-banded", "cells", pairCells, [&] {
+            benchmarkSink = benchmarkSink + matcher.search(target, EditMode::Global, expected).distance;
+        });
+        runner.time("ed/myers-infix", "cells", pairCells, [&] {
+            benchmarkSink = benchmarkSink + matcher.search(target, EditMode::Infix, expected).distance;
+        });
+    }
+
+    const std::pair<const char*, AlignmentMode> nwModes[] = {
+        {"nw/full", AlignmentMode::FullMatrix},
+        {"nw/full-wavefront", AlignmentMode::FullMatrix},
+        {"nw/hirschberg", AlignmentMode::Hirschberg},
+        {"nw/adaptive-band", AlignmentMode::Banded},
+    };
+    for (const auto& mode : nwModes) {
+        if (!runner.selected(mode.first)) continue;
+        NeedlemanWunsch nw(queryFile, targetFile);
+        nw.setMode(mode.second);
+        nw.setBand(DEFAULT_BAND_RADIUS, true);
+        nw.setThreads(std::string(mode.first) == "nw/full-wavefront" ? threads : 1);
+        runner.phases(mode.first, nw, [&] { return nw.cigar().length(); }, 0);
+    }
+
+    if (!options.keep) {
+        std::remove(gcFile.c_str());
+        std::remove(queryFile.c_str());
+        std::remove(targetFile.c_str());
+    }
+}
+
+int main(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    bool usage = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--size" && hasValue) {
+            options.gcBases = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--records" && hasValue) {
+            options.records = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--gc" && hasValue) {
+            options.gcFraction = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--line-width" && hasValue) {
+            options.lineWidth = std::max<size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        } else if (arg == "--align-length" && hasValue) {
+            options.alignLength = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--divergence" && hasValue) {
+            options.divergence = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--warmup" && hasValue) {
+            options.warmup = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--reps" && hasValue) {
+            options.reps = std::max<size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        } else if ((arg == "-t" || arg == "--threads") && hasValue) {
+            options.threads = std::strtoul(argv[++i], nullptr, 10);  // 0 = all cores
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--dir" && hasValue) {
+            options.dir = argv[++i];
+        } else if (arg == "--only" && hasValue) {
+            options.only = argv[++i];
+        } else if (arg == "--binary" && hasValue) {
+            options.binaries.push_back(argv[++i]);
+        } else if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--keep") {
+            options.keep = true;
+        } else {
+            usage = true;
+        }
+    }
+
+    if (usage) {
+        std::cerr << "Usage: " << argv[0] << " [options]" << std::endl;
+        std::cerr << "  --size N          bases of synthetic GC input (default " << options.gcBases << ")" << std::endl;
+        std::cerr << "  --records N       split the GC input into N records (default " << options.records << ")" << std::endl;
+        std::cerr << "  --gc F            GC fraction of generated bases (default " << options.gcFraction << ")" << std::endl;
+        std::cerr << "  --line-width N    FASTA line width (default " << options.lineWidth << ")" << std::endl;
+        std::cerr << "  --align-length N  length of the alignment inputs (default " << options.alignLength << ")" << std::endl;
+        std::cerr << "  --divergence F    mutation rate between the alignment inputs (default " << options.divergence << ")" << std::endl;
+        std::cerr << "  --warmup N        untimed runs before measuring (default " << options.warmup << ")" << std::endl;
+        std::cerr << "  --reps N          timed runs per benchmark (default " << options.reps << ")" << std::endl;
+        std::cerr << "  -t, --threads N   threads for the parallel GC counter (0 = all cores)" << std::endl;
+        std::cerr << "  --seed N          random seed of the synthetic inputs" << std::endl;
+        std::cerr << "  --dir D           where the inputs are written (default .)" << std::endl;
+        std::cerr << "  --keep            keep the generated inputs" << std::endl;
+        std::cerr << "  --only PREFIX     only run benchmarks whose name starts with PREFIX (gc/, sw/, ed/, nw/, exec/)" << std::endl;
+        std::cerr << "  --binary PATH     also time 'PATH <input.fa>', e.g. ./gc_content for the OpenCL path" << std::endl;
+        std::cerr << "  --json            write JSON lines instead of TSV" << std::endl;
+        return 1;
+    }
+
+    try {
+        runBenchmarks(options, std::cout);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
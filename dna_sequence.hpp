@@ -0,0 +1,338 @@
+#ifndef DNA_SEQUENCE_HPP
+#define DNA_SEQUENCE_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cctype>
+#include <algorithm>
+#include <iterator>
+#include "fasta_reader.hpp"
+#include "fasta_index.hpp"
+#include "gc_counter.hpp"
+
+// 2-bit code of A, C, G or T in either case, -1 for anything else. C (01)
+// and G (10) are exactly the codes whose two bits differ.
+inline int dnaCode(char base) {
+    switch (base | 0x20) {
+        case 'a': return 0;
+        case 'c': return 1;
+        case 'g': return 2;
+        case 't': return 3;
+        default: return -1;
+    }
+}
+
+// Reverse complement of bases, case kept; characters other than A/C/G/T
+// stay as they are (N is its own complement)
+inline std::string reverseComplement(std::string_view bases) {
+    std::string result(bases.rbegin(), bases.rend());
+    for (char& base : result) {
+        int code = dnaCode(base);
+        if (code >= 0) base = static_cast<char>("TGCA"[code] | (base & 0x20));
+    }
+    return result;
+}
+
+class DnaSequenceView;
+
+// Nucleotide sequence packed at 2 bits per base, 32 bases per 64-bit word.
+// Characters other than A/C/G/T (N runs, IUPAC codes) are kept as runs in a
+// sparse side table and soft-masked (lower case) stretches as intervals, so
+// every character of the input is reproduced exactly. Random access is a
+// shift plus two binary searches over the usually tiny side tables;
+// iteration walks the tables along with the position instead.
+class DnaSequence {
+public:
+    // A run of one character that has no 2-bit code; packed as code 0
+    struct ExceptionRun {
+        size_t start;
+        size_t length;
+        char base;
+    };
+
+    // A stretch of lower-case (soft-masked) characters
+    struct MaskRun {
+        size_t start;
+        size_t length;
+    };
+
+    class Iterator;
+
+private:
+    static const size_t BASES_PER_WORD = 32;
+
+    std::vector<uint64_t> words;            // base k in bits 2*(k % 32) of word k / 32
+    size_t count = 0;
+    std::vector<ExceptionRun> exceptions;   // sorted, non-overlapping
+    std::vector<MaskRun> masks;             // sorted, non-overlapping
+
+    // Index of the first run that ends after pos
+    template <typename Run>
+    static size_t firstRunEndingAfter(const std::vector<Run>& runs, size_t pos) {
+        return std::partition_point(runs.begin(), runs.end(), [pos](const Run& run) {
+            return run.start + run.length <= pos;
+        }) - runs.begin();
+    }
+
+    template <typename Run>
+    static const Run* findRun(const std::vector<Run>& runs, size_t pos) {
+        size_t k = firstRunEndingAfter(runs, pos);
+        return k < runs.size() && runs[k].start <= pos ? &runs[k] : nullptr;
+    }
+
+public:
+    DnaSequence() = default;
+
+    explicit DnaSequence(std::string_view bases) {
+        reserve(bases.size());
+        append(bases);
+    }
+
+    void reserve(size_t bases) {
+        words.reserve((bases + BASES_PER_WORD - 1) / BASES_PER_WORD);
+    }
+
+    void push_back(char base) {
+        size_t pos = count++;
+        if (pos % BASES_PER_WORD == 0) words.push_back(0);
+
+        int code = dnaCode(base);
+        if (code < 0) {
+            if (!exceptions.empty() && exceptions.back().base == base &&
+                exceptions.back().start + exceptions.back().length == pos) {
+                exceptions.back().length++;
+            } else {
+                exceptions.push_back({pos, 1, base});
+            }
+            code = 0;
+        }
+        words.back() |= static_cast<uint64_t>(code) << (2 * (pos % BASES_PER_WORD));
+
+        if (std::islower(static_cast<unsigned char>(base))) {
+            if (!masks.empty() && masks.back().start + masks.back().length == pos) {
+                masks.back().length++;
+            } else {
+                masks.push_back({pos, 1});
+            }
+        }
+    }
+
+    // Runs continue across calls, so appending line by line packs the same
+    // way as appending the whole sequence at once
+    void append(std::string_view bases) {
+        for (char base : bases) push_back(base);
+    }
+
+    // Append a FASTA record's sequence, whitespace removed as in FastaRecord::appendTo
+    void appendRecord(const FastaRecord& record) {
+        reserve(count + record.body.size());
+        record.forEachLine([&](std::string_view line) {
+            for (char base : line) {
+                if (!std::isspace(static_cast<unsigned char>(base))) push_back(base);
+            }
+        });
+    }
+
+    size_t size() const { return count; }
+    size_t length() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Bytes held by the packed words and side tables
+    size_t memoryUsage() const {
+        return words.capacity() * sizeof(uint64_t) + exceptions.capacity() * sizeof(ExceptionRun) +
+               masks.capacity() * sizeof(MaskRun);
+    }
+
+    const std::vector<uint64_t>& packedWords() const { return words; }
+    const std::vector<ExceptionRun>& exceptionRuns() const { return exceptions; }
+    const std::vector<MaskRun>& maskRuns() const { return masks; }
+
+    // 2-bit code at pos; 0 for exception characters
+    unsigned code(size_t pos) const {
+        return (words[pos / BASES_PER_WORD] >> (2 * (pos % BASES_PER_WORD))) & 3;
+    }
+
+    bool isException(size_t pos) const { return findRun(exceptions, pos) != nullptr; }
+
+    char operator[](size_t pos) const {
+        if (const ExceptionRun* run = findRun(exceptions, pos)) return run->base;
+        char base = "ACGT"[code(pos)];
+        return findRun(masks, pos) ? static_cast<char>(base | 0x20) : base;
+    }
+
+    // Characters [pos, pos + len) into out, replacing its contents
+    void decode(size_t pos, size_t len, std::string& out) const {
+        out.resize(len);
+        for (size_t k = 0; k < len; ++k) {
+            out[k] = "ACGT"[code(pos + k)];
+        }
+        size_t end = pos + len;
+        for (size_t r = firstRunEndingAfter(masks, pos); r < masks.size() && masks[r].start < end; ++r) {
+            size_t from = std::max(masks[r].start, pos);
+            size_t to = std::min(masks[r].start + masks[r].length, end);
+            for (size_t k = from; k < to; ++k) out[k - pos] |= 0x20;
+        }
+        for (size_t r = firstRunEndingAfter(exceptions, pos); r < exceptions.size() && exceptions[r].start < end; ++r) {
+            size_t from = std::max(exceptions[r].start, pos);
+            size_t to = std::min(exceptions[r].start + exceptions[r].length, end);
+            std::fill(out.begin() + (from - pos), out.begin() + (to - pos), exceptions[r].base);
+        }
+    }
+
+    std::string substr(size_t pos, size_t len) const {
+        std::string out;
+        decode(pos, std::min(len, count - pos), out);
+        return out;
+    }
+
+    std::string str() const { return substr(0, count); }
+
+    // GC, N and length of [pos, pos + len): one popcount per 32 bases, with
+    // N taken from the exception runs (exceptions are packed as A, never GC)
+    GCCounts gcCounts(size_t pos, size_t len) const {
+        GCCounts counts;
+        counts.length = len;
+        size_t end = pos + len;
+        for (size_t w = pos / BASES_PER_WORD; w * BASES_PER_WORD < end; ++w) {
+            uint64_t differ = (words[w] ^ (words[w] >> 1)) & 0x5555555555555555ULL;
+            size_t lo = w * BASES_PER_WORD < pos ? pos - w * BASES_PER_WORD : 0;
+            size_t hi = std::min(BASES_PER_WORD, end - w * BASES_PER_WORD);
+            uint64_t keep = hi == BASES_PER_WORD ? ~0ULL : (1ULL << (2 * hi)) - 1;
+            keep &= ~((1ULL << (2 * lo)) - 1);
+            counts.gc += __builtin_popcountll(differ & keep);
+        }
+        for (size_t r = firstRunEndingAfter(exceptions, pos); r < exceptions.size() && exceptions[r].start < end; ++r) {
+            if ((exceptions[r].base | 0x20) != 'n') continue;
+            counts.n += std::min(exceptions[r].start + exceptions[r].length, end) - std::max(exceptions[r].start, pos);
+        }
+        return counts;
+    }
+
+    GCCounts gcCounts() const { return gcCounts(0, count); }
+
+    Iterator begin() const;
+    Iterator end() const;
+    Iterator iteratorAt(size_t pos) const;
+
+    DnaSequenceView subsequence(size_t pos, size_t len) const;
+};
+
+// Forward iterator yielding characters; keeps its place in the side tables
+// so a scan costs O(1) per base
+class DnaSequence::Iterator {
+private:
+    const DnaSequence* sequence = nullptr;
+    size_t pos = 0;
+    size_t exception = 0;  // first exception run ending after pos
+    size_t mask = 0;       // first mask run ending after pos
+
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = char;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const char*;
+    using reference = char;
+
+    Iterator() = default;
+
+    Iterator(const DnaSequence* s, size_t p)
+        : sequence(s), pos(p),
+          exception(firstRunEndingAfter(s->exceptions, p)),
+          mask(firstRunEndingAfter(s->masks, p)) {}
+
+    char operator*() const {
+        const std::vector<ExceptionRun>& exceptions = sequence->exceptions;
+        if (exception < exceptions.size() && exceptions[exception].start <= pos) {
+            return exceptions[exception].base;
+        }
+        char base = "ACGT"[sequence->code(pos)];
+        const std::vector<MaskRun>& masks = sequence->masks;
+        return mask < masks.size() && masks[mask].start <= pos ? static_cast<char>(base | 0x20) : base;
+    }
+
+    Iterator& operator++() {
+        ++pos;
+        const std::vector<ExceptionRun>& exceptions = sequence->exceptions;
+        if (exception < exceptions.size() && exceptions[exception].start + exceptions[exception].length <= pos) {
+            ++exception;
+        }
+        const std::vector<MaskRun>& masks = sequence->masks;
+        if (mask < masks.size() && masks[mask].start + masks[mask].length <= pos) {
+            ++mask;
+        }
+        return *this;
+    }
+
+    Iterator operator++(int) {
+        Iterator previous = *this;
+        ++*this;
+        return previous;
+    }
+
+    size_t position() const { return pos; }
+
+    bool operator==(const Iterator& other) const { return pos == other.pos; }
+    bool operator!=(const Iterator& other) const { return pos != other.pos; }
+};
+
+inline DnaSequence::Iterator DnaSequence::begin() const { return Iterator(this, 0); }
+inline DnaSequence::Iterator DnaSequence::end() const { return Iterator(this, count); }
+inline DnaSequence::Iterator DnaSequence::iteratorAt(size_t pos) const { return Iterator(this, pos); }
+
+// Non-owning window [offset, offset + size()) of a DnaSequence
+class DnaSequenceView {
+private:
+    const DnaSequence* sequence = nullptr;
+    size_t offset = 0;
+    size_t count = 0;
+
+public:
+    DnaSequenceView() = default;
+    DnaSequenceView(const DnaSequence& s, size_t pos, size_t len)
+        : sequence(&s), offset(pos), count(len) {}
+
+    size_t size() const { return count; }
+    size_t length() const { return count; }
+    bool empty() const { return count == 0; }
+
+    char operator[](size_t pos) const { return (*sequence)[offset + pos]; }
+    unsigned code(size_t pos) const { return sequence->code(offset + pos); }
+
+    DnaSequence::Iterator begin() const { return sequence->iteratorAt(offset); }
+    DnaSequence::Iterator end() const { return sequence->iteratorAt(offset + count); }
+
+    void decode(size_t pos, size_t len, std::string& out) const { sequence->decode(offset + pos, len, out); }
+    std::string str() const { return sequence->substr(offset, count); }
+    GCCounts gcCounts() const { return sequence->gcCounts(offset, count); }
+
+    DnaSequenceView subsequence(size_t pos, size_t len) const {
+        return DnaSequenceView(*sequence, offset + pos, std::min(len, count - pos));
+    }
+};
+
+inline DnaSequenceView DnaSequence::subsequence(size_t pos, size_t len) const {
+    return DnaSequenceView(*this, pos, std::min(len, count - pos));
+}
+
+// First record of filename, packed
+inline DnaSequence readFirstDnaSequence(const std::string& filename) {
+    FastaReader reader(filename);
+    FastaRecord record;
+    DnaSequence sequence;
+    if (reader.next(record)) sequence.appendRecord(record);
+    return sequence;
+}
+
+// A record or part of one ("name", "name:start-end", 1-based as in samtools
+// faidx) through the file's .fai index; the first record when region is empty
+inline DnaSequence readDnaSequence(const std::string& filename, const std::string& region) {
+    if (region.empty()) return readFirstDnaSequence(filename);
+    IndexedFasta fasta(filename);
+    DnaSequence sequence;
+    fasta.forEachLine(fasta.region(region), [&](std::string_view line) { sequence.append(line); });
+    return sequence;
+}
+
+#endif
@@ -0,0 +1,219 @@
+#ifndef EDIT_DISTANCE_HPP
+#define EDIT_DISTANCE_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <limits>
+#include <cstdint>
+#include <cctype>
+#include <algorithm>
+
+// Myers' bit-vector edit distance (unit costs: Levenshtein distance, case
+// ignored). The pattern is the DP column, 64 rows per machine word, and the
+// text streams through one column at a time, so a column costs one pass of
+// a dozen word operations per block instead of one DP cell per row.
+//
+// Long patterns use Myers' blocks with Ukkonen's cut-off: only blocks that
+// can still hold a value <= k are computed, extended downwards when a
+// value <= k reaches a block's last row and dropped when every value in the
+// last block exceeds k. Global distances also drop blocks from the top once
+// the band |i - j| <= k has moved past them (Hyyro's banded variant at block
+// granularity). With a small k only O(k / 64) blocks per column are live.
+//
+// Blocks outside the live range are treated as all +1 deltas, which only
+// overestimates values above k; every value <= k is exact because an
+// optimal path never leaves cells <= k. A result above k is reported as
+// "not within k" rather than as a distance.
+
+// Distance and where the match ends; found is false when the distance
+// exceeds the bound given to the search
+struct EditHit {
+    bool found = false;
+    int distance = 0;
+    size_t end = 0;  // text position one past the last matched character
+};
+
+// How the pattern is matched against the text
+enum class EditMode {
+    Global,  // whole pattern against the whole text
+    Infix    // whole pattern against any substring of the text (free text ends)
+};
+
+class MyersMatcher {
+private:
+    using Word = uint64_t;
+    static constexpr int WORD_BITS = 64;
+
+    // Live state of one block of rows in the current column
+    struct Block {
+        Word pv = ~Word(0);  // vertical deltas +1
+        Word mv = 0;         // vertical deltas -1
+        int score = 0;       // value of the block's last row
+    };
+
+    size_t patternLength = 0;
+    size_t blockCount = 0;
+    std::array<uint8_t, 256> symbolOf{};  // byte -> alphabet index, 0 = not in pattern
+    std::vector<Word> peq;                // peq[symbol * blockCount + b]: rows equal to symbol
+
+    int rowsIn(size_t block) const {
+        return block + 1 < blockCount ? WORD_BITS : static_cast<int>(patternLength - block * WORD_BITS);
+    }
+
+    Word lastRowBit(size_t block) const { return Word(1) << (rowsIn(block) - 1); }
+
+    // Advance one block by one text column; hin/hout are the horizontal
+    // deltas entering the block's top row and leaving its last row
+    static int advanceBlock(Block& block, Word eq, int hin, Word lastBit) {
+        Word pv = block.pv, mv = block.mv;
+        Word xv = eq | mv;
+        if (hin < 0) eq |= 1;
+        Word xh = (((eq & pv) + pv) ^ pv) | eq;
+        Word ph = mv | ~(xh | pv);
+        Word mh = pv & xh;
+
+        int hout = 0;
+        if (ph & lastBit) hout = 1;
+        if (mh & lastBit) hout = -1;
+
+        ph <<= 1;
+        mh <<= 1;
+        if (hin < 0) {
+            mh |= 1;
+        } else if (hin > 0) {
+            ph |= 1;
+        }
+        block.pv = mh | ~(xv | ph);
+        block.mv = ph & xv;
+        block.score += hout;
+        return hout;
+    }
+
+public:
+    MyersMatcher() = default;
+
+    explicit MyersMatcher(std::string_view pattern) { setPattern(pattern); }
+
+    void setPattern(std::string_view pattern) {
+        patternLength = pattern.size();
+        blockCount = (patternLength + WORD_BITS - 1) / WORD_BITS;
+        symbolOf.fill(0);
+
+        // Alphabet of the pattern, case folded; index 0 matches nothing
+        size_t symbols = 1;
+        for (char c : pattern) {
+            unsigned char upper = static_cast<unsigned char>(std::toupper(static_cast<unsigned char>(c)));
+            if (symbolOf[upper] == 0) {
+                symbolOf[upper] = static_cast<uint8_t>(symbols++);
+                symbolOf[std::tolower(upper)] = symbolOf[upper];
+            }
+        }
+        peq.assign(symbols * blockCount, 0);
+        for (size_t i = 0; i < patternLength; ++i) {
+            size_t symbol = symbolOf[static_cast<unsigned char>(pattern[i])];
+            peq[symbol * blockCount + i / WORD_BITS] |= Word(1) << (i % WORD_BITS);
+        }
+    }
+
+    size_t length() const { return patternLength; }
+
+    // Best match of the pattern in text with at most maxDistance edits
+    // (negative: no bound). Infix reports the first end position reaching
+    // the smallest distance.
+    EditHit search(std::string_view text, EditMode mode, int maxDistance = -1) const {
+        EditHit hit;
+        const size_t n = text.size();
+        const int m = static_cast<int>(patternLength);
+        const int longest = static_cast<int>(std::min<size_t>(std::max(patternLength, n), std::numeric_limits<int>::max() - 1));
+        const int k = maxDistance < 0 ? longest : std::min(maxDistance, longest);
+
+        if (m == 0) {
+            hit.found = mode == EditMode::Infix || static_cast<int>(n) <= k;
+            hit.distance = mode == EditMode::Infix ? 0 : static_cast<int>(n);
+            hit.end = mode == EditMode::Infix ? 0 : text.size();
+            return hit;
+        }
+
+        // Top row: D[0][j] = j for Global, 0 for Infix (the match may start anywhere)
+        const int topDelta = mode == EditMode::Global ? 1 : 0;
+
+        std::vector<Block> blocks(blockCount);
+        size_t first = 0;
+        size_t last = std::min(blockCount - 1, static_cast<size_t>(k) / WORD_BITS);
+        for (size_t b = 0; b <= last; ++b) {
+            blocks[b].score = static_cast<int>(b * WORD_BITS) + rowsIn(b);  // D[i][0] = i
+        }
+
+        int best = k + 1;
+        if (mode == EditMode::Infix && m <= k) {
+            best = m;  // deleting the whole pattern matches the empty text prefix
+        }
+        for (size_t j = 0; j < n; ++j) {
+            const Word* eq = &peq[symbolOf[static_cast<unsigned char>(text[j])] * blockCount];
+
+            int h = topDelta;
+            for (size_t b = first; b <= last; ++b) {
+                h = advanceBlock(blocks[b], eq[b], h, lastRowBit(b));
+            }
+
+            // Extend downwards while a value <= k may reach the next block
+            while (last + 1 < blockCount && blocks[last].score - std::max(h, 0) <= k) {
+                Block& next = blocks[++last];
+                next = Block();
+                next.score = blocks[last - 1].score - h + rowsIn(last);  // previous column, +1 per row
+                h = advanceBlock(next, eq[last], h, lastRowBit(last));
+            }
+
+            // Drop bottom blocks whose every value exceeds k
+            while (last > first && blocks[last].score >= k + rowsIn(last)) --last;
+
+            // Global: rows more than k above the diagonal can never come back to <= k
+            if (mode == EditMode::Global) {
+                while (first < last && j + 1 > (first + 1) * WORD_BITS + static_cast<size_t>(k)) {
+                    ++first;
+                }
+                if (first == last && blocks[last].score >= k + rowsIn(last)) {
+                    return hit;  // the whole column is above k
+                }
+            }
+
+            if (mode == EditMode::Infix && last == blockCount - 1 && blocks[last].score < best) {
+                best = blocks[last].score;
+                hit.end = j + 1;
+                if (best == 0) break;
+            }
+        }
+
+        if (mode == EditMode::Global) {
+            if (n == 0) {
+                best = m;
+            } else if (last == blockCount - 1) {
+                best = blocks[last].score;
+            }
+            hit.end = text.size();
+        }
+
+        if (best <= k) {
+            hit.found = true;
+            hit.distance = best;
+        }
+        return hit;
+    }
+
+    // Whether the pattern occurs in text with at most maxDistance edits
+    bool within(std::string_view text, int maxDistance, EditMode mode = EditMode::Infix) const {
+        return search(text, mode, maxDistance).found;
+    }
+};
+
+// Levenshtein distance of a and b, or -1 when it exceeds maxDistance
+inline int editDistance(std::string_view a, std::string_view b, int maxDistance = -1) {
+    // The shorter string as the pattern keeps the column short
+    if (a.size() > b.size()) std::swap(a, b);
+    EditHit hit = MyersMatcher(a).search(b, EditMode::Global, maxDistance);
+    return hit.found ? hit.distance : -1;
+}
+
+#endif
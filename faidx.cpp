@@ -0,0 +1,60 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "fasta_index.hpp"
+
+// samtools faidx work-alike: writes <file>.fai and prints the requested
+// records or regions as FASTA
+
+const size_t OUTPUT_LINE_WIDTH = 60;
+
+int main(int argc, char* argv[]) {
+    std::string filename;
+    std::vector<std::string> regions;
+    size_t threads = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-t" || arg == "--threads") && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);  // 0 = all cores
+        } else if (filename.empty()) {
+            filename = arg;
+        } else {
+            regions.push_back(arg);
+        }
+    }
+
+    if (filename.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [-t <threads>] <FASTA file> [region ...]" << std::endl;
+        std::cerr << "  Without regions, (re)builds <FASTA file>.fai. Regions are \"chr\", \"chr:start\" or"
+                  << " \"chr:start-end\", 1-based and inclusive." << std::endl;
+        std::cerr << "  -t, --threads N   index on N threads (0 = all cores)" << std::endl;
+        return 1;
+    }
+
+    try {
+        if (regions.empty()) {
+            MappedFile file(filename);
+            FastaIndex::build(file.view(), threads).save(filename + ".fai");
+            return 0;
+        }
+
+        std::ios::sync_with_stdio(false);
+        IndexedFasta fasta(filename, threads);
+        for (const std::string& text : regions) {
+            std::string sequence = fasta.fetch(text);
+            std::cout << '>' << text << '\n';
+            for (size_t offset = 0; offset < sequence.size(); offset += OUTPUT_LINE_WIDTH) {
+                std::cout.write(sequence.data() + offset, std::min(OUTPUT_LINE_WIDTH, sequence.size() - offset));
+                std::cout << '\n';
+            }
+        }
+        std::cout.flush();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
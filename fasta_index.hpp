@@ -0,0 +1,321 @@
+#ifndef FASTA_INDEX_HPP
+#define FASTA_INDEX_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <future>
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <sys/stat.h>
+#include "fasta_reader.hpp"
+#include "thread_pool.hpp"
+
+// One line of a samtools .fai index
+struct FaiEntry {
+    std::string name;        // header up to the first space or tab
+    uint64_t length = 0;     // bases in the record
+    uint64_t offset = 0;     // file offset of the first base
+    uint64_t lineBases = 0;  // bases per full line
+    uint64_t lineWidth = 0;  // bytes per full line, terminator included
+
+    // File offset of base pos (0-based) of the record
+    uint64_t byteOffset(uint64_t pos) const {
+        return lineBases == 0 ? offset : offset + pos / lineBases * lineWidth + pos % lineBases;
+    }
+};
+
+// Part of a record: 0-based, half-open [start, end) like BED
+struct FastaRegion {
+    std::string name;
+    uint64_t start = 0;
+    uint64_t end = std::numeric_limits<uint64_t>::max();  // clamped to the record length
+};
+
+// samtools-compatible FASTA index. Every record's lines must have the same
+// width except the last, which may be shorter; that is what makes a base's
+// file offset computable. build() splits the file into pieces at record
+// boundaries and indexes them on a thread pool.
+class FastaIndex {
+private:
+    std::vector<FaiEntry> records;
+    std::unordered_map<std::string, size_t> byName;
+
+    void addEntry(FaiEntry entry) {
+        byName.emplace(entry.name, records.size());  // first record wins on duplicate names
+        records.push_back(std::move(entry));
+    }
+
+    static std::runtime_error lineLengthError(const std::string& name) {
+        return std::runtime_error("Different line length in sequence '" + name + "'");
+    }
+
+    // Index the records of data[begin, end); begin is 0 or the '>' of a header
+    static std::vector<FaiEntry> indexPiece(std::string_view data, size_t begin, size_t end) {
+        std::vector<FaiEntry> entries;
+        const char* base = data.data();
+        size_t pos = begin;
+
+        auto lineEnd = [&](size_t from) {
+            const void* eol = std::memchr(base + from, '\n', end - from);
+            return eol ? static_cast<size_t>(static_cast<const char*>(eol) - base) : end;
+        };
+
+        // Blank lines before the first record are allowed, sequence is not
+        while (pos < end && base[pos] != '>') {
+            size_t eol = lineEnd(pos);
+            for (size_t k = pos; k < eol; ++k) {
+                if (base[k] != '\r') throw std::runtime_error("Sequence data before the first header");
+            }
+            pos = eol + 1;
+        }
+
+        while (pos < end) {
+            FaiEntry entry;
+            size_t eol = lineEnd(pos);
+            size_t nameEnd = pos + 1;
+            while (nameEnd < eol && base[nameEnd] != ' ' && base[nameEnd] != '\t' && base[nameEnd] != '\r') ++nameEnd;
+            entry.name.assign(base + pos + 1, nameEnd - pos - 1);
+            if (entry.name.empty()) throw std::runtime_error("Empty sequence name in header");
+            pos = std::min(eol + 1, end);
+            entry.offset = pos;
+
+            // Lines up to the next header: all full, then one short one, then
+            // only blank lines
+            bool shortSeen = false, blankSeen = false;
+            while (pos < end && base[pos] != '>') {
+                eol = lineEnd(pos);
+                size_t bases = eol - pos;
+                if (bases > 0 && base[eol - 1] == '\r') --bases;
+                size_t width = std::min(eol + 1, end) - pos;
+                if (bases == 0) {
+                    blankSeen = true;
+                } else if (blankSeen || shortSeen) {
+                    throw lineLengthError(entry.name);
+                } else if (entry.lineBases == 0) {
+                    entry.lineBases = bases;
+                    entry.lineWidth = width;
+                } else if (bases < entry.lineBases) {
+                    shortSeen = true;
+                } else if (bases != entry.lineBases || (width != entry.lineWidth && eol < end)) {
+                    throw lineLengthError(entry.name);
+                }
+                entry.length += bases;
+                pos = eol + 1;
+            }
+            entries.push_back(std::move(entry));
+        }
+        return entries;
+    }
+
+public:
+    // Index the FASTA data of a mapped file, in about threads pieces
+    static FastaIndex build(std::string_view data, size_t threads = 0) {
+        ThreadPool pool(threads);
+        size_t pieces = std::max<size_t>(1, std::min(pool.size() * 4, data.size() >> 22));  // >= 4 MiB each
+
+        // Piece boundaries: the first header at or after each split point
+        std::vector<size_t> bounds{0};
+        for (size_t k = 1; k < pieces; ++k) {
+            size_t pos = std::max(bounds.back() + 1, data.size() / pieces * k);
+            while (pos < data.size() && !(data[pos] == '>' && data[pos - 1] == '\n')) {
+                const void* hit = std::memchr(data.data() + pos + 1, '>', data.size() - pos - 1);
+                pos = hit ? static_cast<const char*>(hit) - data.data() : data.size();
+            }
+            if (pos >= data.size()) break;
+            bounds.push_back(pos);
+        }
+        bounds.push_back(data.size());
+
+        std::vector<std::future<std::vector<FaiEntry>>> parts;
+        for (size_t k = 0; k + 1 < bounds.size(); ++k) {
+            size_t begin = bounds[k], end = bounds[k + 1];
+            parts.push_back(pool.submit([data, begin, end] { return indexPiece(data, begin, end); }));
+        }
+
+        FastaIndex index;
+        for (auto& part : parts) {
+            for (FaiEntry& entry : part.get()) index.addEntry(std::move(entry));
+        }
+        return index;
+    }
+
+    // Read a .fai file
+    static FastaIndex load(const std::string& faiFile) {
+        std::ifstream in(faiFile);
+        if (!in) {
+            throw std::runtime_error("Cannot open file: " + faiFile);
+        }
+        FastaIndex index;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty()) continue;
+            std::istringstream fields(line);
+            FaiEntry entry;
+            if (!std::getline(fields, entry.name, '\t') ||
+                !(fields >> entry.length >> entry.offset >> entry.lineBases >> entry.lineWidth)) {
+                throw std::runtime_error("Malformed index line in " + faiFile + ": " + line);
+            }
+            index.addEntry(std::move(entry));
+        }
+        return index;
+    }
+
+    void save(const std::string& faiFile) const {
+        std::ofstream out(faiFile);
+        for (const FaiEntry& entry : records) {
+            out << entry.name << '\t' << entry.length << '\t' << entry.offset << '\t'
+                << entry.lineBases << '\t' << entry.lineWidth << '\n';
+        }
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Cannot write file: " + faiFile);
+        }
+    }
+
+    const std::vector<FaiEntry>& entries() const { return records; }
+
+    // Entry of the named record, nullptr if there is none
+    const FaiEntry* find(std::string_view name) const {
+        auto it = byName.find(std::string(name));
+        return it == byName.end() ? nullptr : &records[it->second];
+    }
+
+    // Parse a samtools-style region: "name", "name:start" or "name:start-end"
+    // with 1-based inclusive coordinates and optional thousands separators.
+    // A name that itself contains ':' is matched whole first.
+    FastaRegion parseRegion(const std::string& text) const {
+        FastaRegion region;
+        if (find(text) != nullptr) {
+            region.name = text;
+            return region;
+        }
+
+        size_t colon = text.rfind(':');
+        if (colon == std::string::npos) {
+            throw std::runtime_error("Unknown sequence name: " + text);
+        }
+        region.name = text.substr(0, colon);
+        if (find(region.name) == nullptr) {
+            throw std::runtime_error("Unknown sequence name: " + region.name);
+        }
+
+        std::string range;
+        for (char c : text.substr(colon + 1)) {
+            if (c != ',') range += c;
+        }
+        auto number = [&](const std::string& digits) {
+            if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos) {
+                throw std::runtime_error("Invalid region: " + text);
+            }
+            return std::stoull(digits);
+        };
+        size_t dash = range.find('-');
+        uint64_t first = number(range.substr(0, dash));
+        region.start = first == 0 ? 0 : first - 1;
+        if (dash != std::string::npos) {
+            region.end = number(range.substr(dash + 1));
+            if (region.end < region.start) {
+                throw std::runtime_error("Invalid region: " + text);
+            }
+        }
+        return region;
+    }
+};
+
+// Random access to the records and regions of an indexed FASTA file. The
+// index is read from <file>.fai when it is at least as new as the FASTA file,
+// otherwise built and saved there (kept in memory only if that fails). The
+// file is memory-mapped, so a fetch reads only the pages it touches.
+class IndexedFasta {
+private:
+    MappedFile file;
+    FastaIndex faiIndex;
+
+    const FaiEntry& entryOf(const FastaRegion& region) const {
+        const FaiEntry* entry = faiIndex.find(region.name);
+        if (entry == nullptr) {
+            throw std::runtime_error("Unknown sequence name: " + region.name);
+        }
+        return *entry;
+    }
+
+public:
+    explicit IndexedFasta(const std::string& filename, size_t threads = 0) : file(filename) {
+        file.adviseRandom();
+        std::string faiFile = filename + ".fai";
+        struct stat fasta, fai;
+        if (stat(filename.c_str(), &fasta) == 0 && stat(faiFile.c_str(), &fai) == 0 &&
+            fai.st_mtime >= fasta.st_mtime) {
+            faiIndex = FastaIndex::load(faiFile);
+            return;
+        }
+        faiIndex = FastaIndex::build(file.view(), threads);
+        try {
+            faiIndex.save(faiFile);
+        } catch (const std::exception&) {
+            // Read-only location: the in-memory index still works
+        }
+    }
+
+    const FastaIndex& index() const { return faiIndex; }
+
+    // Region from samtools-style text, end clamped to the record length
+    FastaRegion region(const std::string& text) const {
+        FastaRegion result = faiIndex.parseRegion(text);
+        clamp(result);
+        return result;
+    }
+
+    // Clamp region.end (and start) to the record length
+    void clamp(FastaRegion& region) const {
+        const FaiEntry& entry = entryOf(region);
+        region.end = std::min(region.end, entry.length);
+        region.start = std::min(region.start, region.end);
+    }
+
+    // Raw bytes holding the region, line breaks included; countGC skips them
+    std::string_view raw(const FastaRegion& region) const {
+        const FaiEntry& entry = entryOf(region);
+        uint64_t end = std::min(region.end, entry.length);
+        if (region.start >= end) return std::string_view();
+        uint64_t first = entry.byteOffset(region.start);
+        uint64_t last = entry.byteOffset(end - 1) + 1;
+        if (last > file.size()) {
+            throw std::runtime_error("Index does not match the FASTA file for " + region.name);
+        }
+        return std::string_view(file.data() + first, last - first);
+    }
+
+    // Call fn(std::string_view) for the region's bases line by line
+    template <typename Fn>
+    void forEachLine(const FastaRegion& region, Fn&& fn) const {
+        const FaiEntry& entry = entryOf(region);
+        uint64_t end = std::min(region.end, entry.length);
+        std::string_view bytes = raw(region);
+        size_t offset = 0;
+        for (uint64_t pos = region.start; pos < end;) {
+            uint64_t take = std::min(end - pos, entry.lineBases - pos % entry.lineBases);
+            fn(bytes.substr(offset, take));
+            pos += take;
+            offset += take + (entry.lineWidth - entry.lineBases);
+        }
+    }
+
+    // The region's bases as one string
+    std::string fetch(const FastaRegion& region) const {
+        std::string sequence;
+        forEachLine(region, [&](std::string_view line) { sequence += line; });
+        return sequence;
+    }
+
+    std::string fetch(const std::string& text) const { return fetch(region(text)); }
+};
+
+#endif
@@ -0,0 +1,254 @@
+#ifndef FASTA_READER_HPP
+#define FASTA_READER_HPP
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <cstring>
+#include <cctype>
+#include <iterator>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+private:
+    const char* mapping = nullptr;
+    size_t mappedSize = 0;
+
+    void release() {
+        if (mapping != nullptr) {
+            munmap(const_cast<char*>(mapping), mappedSize);
+        }
+        mapping = nullptr;
+        mappedSize = 0;
+    }
+
+public:
+    explicit MappedFile(const std::string& filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open file: " + filename);
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw std::runtime_error("Cannot stat file: " + filename);
+        }
+
+        mappedSize = static_cast<size_t>(info.st_size);
+        if (mappedSize > 0) {
+            void* addr = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Cannot map file: " + filename);
+            }
+            // Records are scanned front to back, let the kernel read ahead
+            madvise(addr, mappedSize, MADV_SEQUENTIAL);
+            mapping = static_cast<const char*>(addr);
+        }
+        close(fd);
+    }
+
+    ~MappedFile() { release(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept
+        : mapping(other.mapping), mappedSize(other.mappedSize) {
+        other.mapping = nullptr;
+        other.mappedSize = 0;
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            release();
+            mapping = other.mapping;
+            mappedSize = other.mappedSize;
+            other.mapping = nullptr;
+            other.mappedSize = 0;
+        }
+        return *this;
+    }
+
+    const char* data() const { return mapping; }
+    size_t size() const { return mappedSize; }
+
+    // For lookups by offset (indexed access) rather than front-to-back scans
+    void adviseRandom() {
+        if (mapping != nullptr) madvise(const_cast<char*>(mapping), mappedSize, MADV_RANDOM);
+    }
+    std::string_view view() const { return std::string_view(mapping, mappedSize); }
+};
+
+// One FASTA record as views into the mapped file; nothing is copied
+struct FastaRecord {
+    std::string_view header;  // header line without '>' and line terminator
+    std::string_view body;    // raw sequence lines, line breaks included
+
+    // Sequence name: the header up to the first space
+    std::string_view name() const {
+        return header.substr(0, header.find(' '));
+    }
+
+    // Call fn(std::string_view) for every sequence line, without "\n" or "\r\n"
+    template <typename Fn>
+    void forEachLine(Fn&& fn) const {
+        const char* p = body.data();
+        const char* end = p + body.size();
+        while (p < end) {
+            const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            const char* lineEnd = eol ? eol : end;
+            const char* contentEnd = lineEnd;
+            if (contentEnd > p && contentEnd[-1] == '\r') {
+                --contentEnd;
+            }
+            if (contentEnd > p) {
+                fn(std::string_view(p, contentEnd - p));
+            }
+            p = eol ? eol + 1 : end;
+        }
+    }
+
+    // True when the record has no sequence characters at all
+    bool empty() const {
+        for (char c : body) {
+            if (c != '\n' && c != '\r') return false;
+        }
+        return true;
+    }
+
+    // Number of sequence characters, line terminators excluded
+    size_t length() const {
+        size_t total = 0;
+        forEachLine([&](std::string_view line) { total += line.size(); });
+        return total;
+    }
+
+    // Append the sequence to out with all whitespace removed (one copy, one allocation)
+    void appendTo(std::string& out) const {
+        out.reserve(out.size() + body.size());
+        forEachLine([&](std::string_view line) {
+            for (char c : line) {
+                if (!std::isspace(static_cast<unsigned char>(c))) out += c;
+            }
+        });
+    }
+
+    // Materialize the sequence for code that needs contiguous bases
+    std::string sequence() const {
+        std::string result;
+        appendTo(result);
+        return result;
+    }
+};
+
+// Forward iterator over the records of a memory-mapped FASTA file.
+// Handles multi-line records, CRLF line endings and blank lines. Sequence
+// lines before the first '>' are returned as a record with an empty header.
+class FastaReader {
+private:
+    MappedFile file;
+    size_t position = 0;
+
+    // Offset of the next header line at or after from, or the end of the file
+    size_t findNextHeader(size_t from) const {
+        const char* base = file.data();
+        size_t size = file.size();
+        while (from < size) {
+            const void* hit = std::memchr(base + from, '>', size - from);
+            if (hit == nullptr) return size;
+            size_t offset = static_cast<const char*>(hit) - base;
+            if (offset == 0 || base[offset - 1] == '\n') return offset;
+            from = offset + 1;
+        }
+        return size;
+    }
+
+public:
+    explicit FastaReader(const std::string& filename) : file(filename) {}
+
+    // Fill record with the next record; returns false at end of file
+    bool next(FastaRecord& record) {
+        const char* base = file.data();
+        size_t size = file.size();
+
+        // Skip blank lines between records
+        while (position < size && (base[position] == '\n' || base[position] == '\r')) {
+            ++position;
+        }
+        if (position >= size) return false;
+
+        size_t bodyStart = position;
+        record.header = std::string_view();
+        if (base[position] == '>') {
+            const void* eol = std::memchr(base + position, '\n', size - position);
+            size_t lineEnd = eol ? static_cast<const char*>(eol) - base : size;
+            size_t headerEnd = lineEnd;
+            if (headerEnd > position + 1 && base[headerEnd - 1] == '\r') {
+                --headerEnd;
+            }
+            record.header = std::string_view(base + position + 1, headerEnd - position - 1);
+            bodyStart = eol ? lineEnd + 1 : size;
+        }
+
+        size_t bodyEnd = findNextHeader(bodyStart);
+        record.body = std::string_view(base + bodyStart, bodyEnd - bodyStart);
+        position = bodyEnd;
+        return true;
+    }
+
+    // Start again from the first record
+    void rewind() { position = 0; }
+
+    const MappedFile& mappedFile() const { return file; }
+
+    class Iterator {
+    private:
+        FastaReader* reader;
+        FastaRecord record;
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = FastaRecord;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const FastaRecord*;
+        using reference = const FastaRecord&;
+
+        explicit Iterator(FastaReader* r = nullptr) : reader(r) {
+            if (reader != nullptr && !reader->next(record)) reader = nullptr;
+        }
+
+        reference operator*() const { return record; }
+        pointer operator->() const { return &record; }
+
+        Iterator& operator++() {
+            if (!reader->next(record)) reader = nullptr;
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const { return reader == other.reader; }
+        bool operator!=(const Iterator& other) const { return reader != other.reader; }
+    };
+
+    // Range-for support; begin() restarts from the first record
+    Iterator begin() {
+        rewind();
+        return Iterator(this);
+    }
+    Iterator end() { return Iterator(); }
+};
+
+// Sequence of the first record in filename, as used by the pairwise aligners
+inline std::string readFirstSequence(const std::string& filename) {
+    FastaReader reader(filename);
+    FastaRecord record;
+    if (!reader.next(record)) return std::string();
+    return record.sequence();
+}
+
+#endif
@@ -0,0 +1,403 @@
+#ifndef FASTA_STREAM_HPP
+#define FASTA_STREAM_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "gc_counter.hpp"
+#include "thread_pool.hpp"
+
+// Sequential source of bytes for input that cannot be memory-mapped: pipes,
+// stdin and compressed files. next() returns the following piece of data,
+// valid until the next call, and an empty view at the end.
+class ByteStream {
+public:
+    virtual ~ByteStream() = default;
+    virtual std::string_view next() = 0;
+};
+
+// Plain bytes from a file descriptor; "-" is stdin
+class FdStream : public ByteStream {
+private:
+    static const size_t BUFFER_BYTES = 1 << 20;
+
+    int fd = -1;
+    bool owned = false;
+    std::string name;
+    std::vector<char> buffer;
+    std::string pushedBack;  // returned by next() before reading more
+
+public:
+    explicit FdStream(const std::string& filename) : name(filename), buffer(BUFFER_BYTES) {
+        if (filename == "-") {
+            fd = STDIN_FILENO;
+        } else {
+            fd = open(filename.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw std::runtime_error("Cannot open file: " + filename);
+            }
+            owned = true;
+        }
+    }
+
+    ~FdStream() override {
+        if (owned) close(fd);
+    }
+
+    FdStream(const FdStream&) = delete;
+    FdStream& operator=(const FdStream&) = delete;
+
+    // Up to capacity bytes into out; fewer only at the end of the input
+    size_t readFully(char* out, size_t capacity) {
+        size_t total = 0;
+        while (total < capacity) {
+            if (!pushedBack.empty()) {
+                size_t take = std::min(capacity - total, pushedBack.size());
+                std::memcpy(out + total, pushedBack.data(), take);
+                pushedBack.erase(0, take);
+                total += take;
+                continue;
+            }
+            ssize_t got = read(fd, out + total, capacity - total);
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("Cannot read file: " + name);
+            }
+            if (got == 0) break;
+            total += static_cast<size_t>(got);
+        }
+        return total;
+    }
+
+    // Hand bytes already consumed (format detection) out again first
+    void unread(std::string_view bytes) { pushedBack.insert(0, bytes.data(), bytes.size()); }
+
+    std::string_view next() override {
+        if (!pushedBack.empty()) {
+            std::memcpy(buffer.data(), pushedBack.data(), pushedBack.size());
+            size_t size = pushedBack.size();
+            pushedBack.clear();
+            return std::string_view(buffer.data(), size);
+        }
+        while (true) {
+            ssize_t got = read(fd, buffer.data(), buffer.size());
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("Cannot read file: " + name);
+            }
+            return std::string_view(buffer.data(), static_cast<size_t>(got));
+        }
+    }
+
+    const std::string& filename() const { return name; }
+};
+
+// Single-threaded gzip decompression; concatenated members (as written by
+// `cat a.gz b.gz` or BGZF) are decompressed one after another
+class GzipStream : public ByteStream {
+private:
+    static const size_t BUFFER_BYTES = 1 << 20;
+
+    std::unique_ptr<FdStream> source;
+    z_stream zs;
+    std::string_view input;     // compressed bytes not yet given to zlib
+    std::vector<char> output;
+    bool finished = false;
+
+    void check(int status) {
+        if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+            throw std::runtime_error("Corrupt gzip data in " + source->filename() +
+                                     (zs.msg != nullptr ? std::string(": ") + zs.msg : std::string()));
+        }
+    }
+
+public:
+    explicit GzipStream(std::unique_ptr<FdStream> in) : source(std::move(in)), output(BUFFER_BYTES) {
+        std::memset(&zs, 0, sizeof(zs));
+        if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+            throw std::runtime_error("Cannot initialize zlib");
+        }
+    }
+
+    ~GzipStream() override { inflateEnd(&zs); }
+
+    GzipStream(const GzipStream&) = delete;
+    GzipStream& operator=(const GzipStream&) = delete;
+
+    std::string_view next() override {
+        zs.next_out = reinterpret_cast<Bytef*>(output.data());
+        zs.avail_out = static_cast<uInt>(output.size());
+        while (!finished && zs.avail_out == output.size()) {
+            if (input.empty()) {
+                input = source->next();
+                if (input.empty()) {
+                    // End of input: fine between members, truncated inside one
+                    if (zs.total_in != 0) {
+                        throw std::runtime_error("Unexpected end of gzip data in " + source->filename());
+                    }
+                    finished = true;
+                    break;
+                }
+            }
+            zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+            zs.avail_in = static_cast<uInt>(input.size());
+            int status = inflate(&zs, Z_NO_FLUSH);
+            check(status);
+            input.remove_prefix(input.size() - zs.avail_in);
+            if (status == Z_STREAM_END) {
+                inflateReset(&zs);  // another member may follow; total_in is 0 again
+            }
+        }
+        return std::string_view(output.data(), output.size() - zs.avail_out);
+    }
+};
+
+// BGZF (blocked gzip, as written by bgzip and htslib): a series of gzip
+// members of at most 64 KiB, each naming its own size in a "BC" extra field.
+// Blocks are read in order on the calling thread, inflated on a thread pool
+// and handed out in order, with at most a fixed number in flight.
+class BgzfStream : public ByteStream {
+private:
+    static const size_t HEADER_BYTES = 12;  // fixed gzip header up to XLEN
+    static const size_t MAX_BLOCK_BYTES = 1 << 16;
+
+    std::unique_ptr<FdStream> source;
+    ThreadPool pool;
+    size_t maxInFlight;
+    std::deque<std::future<std::string>> pending;
+    std::string current;  // block returned by the last next()
+    bool endOfInput = false;
+
+    static uint16_t le16(const unsigned char* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+    static uint32_t le32(const unsigned char* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    // Raw deflate payload of one block, checked against its CRC32 and size
+    static std::string inflateBlock(const std::string& block, size_t dataOffset, const std::string& filename) {
+        const unsigned char* trailer = reinterpret_cast<const unsigned char*>(block.data() + block.size() - 8);
+        uint32_t crc = le32(trailer);
+        uint32_t size = le32(trailer + 4);
+        if (size > MAX_BLOCK_BYTES) {
+            throw std::runtime_error("Corrupt BGZF block in " + filename);
+        }
+        std::string out(size, '\0');
+
+        z_stream zs;
+        std::memset(&zs, 0, sizeof(zs));
+        if (inflateInit2(&zs, -15) != Z_OK) {
+            throw std::runtime_error("Cannot initialize zlib");
+        }
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(block.data() + dataOffset));
+        zs.avail_in = static_cast<uInt>(block.size() - 8 - dataOffset);
+        zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+        zs.avail_out = size;
+        int status = inflate(&zs, Z_FINISH);
+        inflateEnd(&zs);
+        if (status != Z_STREAM_END || zs.avail_out != 0 ||
+            crc32(0, reinterpret_cast<const Bytef*>(out.data()), size) != crc) {
+            throw std::runtime_error("Corrupt BGZF block in " + filename);
+        }
+        return out;
+    }
+
+    // Read the next whole block and queue its decompression; false at the end
+    bool readBlock() {
+        unsigned char header[HEADER_BYTES];
+        size_t got = source->readFully(reinterpret_cast<char*>(header), HEADER_BYTES);
+        if (got == 0) return false;
+        if (got < HEADER_BYTES || header[0] != 0x1f || header[1] != 0x8b || header[2] != 8 || !(header[3] & 4)) {
+            throw std::runtime_error("Not a BGZF block in " + source->filename());
+        }
+
+        size_t extraLength = le16(header + 10);
+        std::string block(reinterpret_cast<char*>(header), HEADER_BYTES);
+        block.resize(HEADER_BYTES + extraLength);
+        if (source->readFully(&block[HEADER_BYTES], extraLength) != extraLength) {
+            throw std::runtime_error("Unexpected end of BGZF data in " + source->filename());
+        }
+
+        // Find BSIZE (total block size - 1) in the "BC" subfield
+        size_t blockSize = 0;
+        const unsigned char* extra = reinterpret_cast<const unsigned char*>(block.data() + HEADER_BYTES);
+        for (size_t k = 0; k + 4 <= extraLength;) {
+            size_t fieldLength = le16(extra + k + 2);
+            if (extra[k] == 'B' && extra[k + 1] == 'C' && fieldLength == 2 && k + 6 <= extraLength) {
+                blockSize = le16(extra + k + 4) + 1;
+            }
+            k += 4 + fieldLength;
+        }
+        size_t dataOffset = HEADER_BYTES + extraLength;
+        if (blockSize < dataOffset + 8) {
+            throw std::runtime_error("Not a BGZF block in " + source->filename());
+        }
+
+        block.resize(blockSize);
+        size_t rest = blockSize - dataOffset;
+        if (source->readFully(&block[dataOffset], rest) != rest) {
+            throw std::runtime_error("Unexpected end of BGZF data in " + source->filename());
+        }
+
+        std::string filename = source->filename();
+        pending.push_back(pool.submit([block = std::move(block), dataOffset, filename] {
+            return inflateBlock(block, dataOffset, filename);
+        }));
+        return true;
+    }
+
+public:
+    // threads == 0 uses every hardware thread
+    BgzfStream(std::unique_ptr<FdStream> in, size_t threads)
+        : source(std::move(in)), pool(threads), maxInFlight(pool.size() * 4) {}
+
+    std::string_view next() override {
+        do {
+            while (!endOfInput && pending.size() < maxInFlight) {
+                endOfInput = !readBlock();
+            }
+            if (pending.empty()) return std::string_view();
+            current = pending.front().get();
+            pending.pop_front();
+        } while (current.empty());  // e.g. the empty end-of-file marker block
+        return current;
+    }
+};
+
+// Open filename ("-" for stdin) as a stream, detecting gzip and BGZF from
+// the first bytes; threads are used for BGZF decompression
+inline std::unique_ptr<ByteStream> openByteStream(const std::string& filename, size_t threads = 0) {
+    auto source = std::make_unique<FdStream>(filename);
+    char magic[16];
+    size_t got = source->readFully(magic, sizeof(magic));
+    source->unread(std::string_view(magic, got));
+
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(magic);
+    if (got < 2 || bytes[0] != 0x1f || bytes[1] != 0x8b) {
+        return source;
+    }
+    // BGZF: FEXTRA set and the first subfield is "BC" with two bytes of data
+    bool bgzf = got >= 16 && (bytes[3] & 4) && bytes[12] == 'B' && bytes[13] == 'C' && bytes[14] == 2 && bytes[15] == 0;
+    if (bgzf) {
+        return std::make_unique<BgzfStream>(std::move(source), threads);
+    }
+    return std::make_unique<GzipStream>(std::move(source));
+}
+
+// Whether filename starts with the gzip magic bytes
+inline bool isGzipFile(const std::string& filename) {
+    FdStream source(filename);
+    unsigned char magic[2];
+    return source.readFully(reinterpret_cast<char*>(magic), 2) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+// Splits a FASTA byte stream into records exactly like FastaReader does: a
+// '>' at the start of a line starts a header, sequence before the first
+// header is a record with an empty name. Only the current header is held
+// (cut at MAX_HEADER_BYTES); record bodies are handed on piece by piece as
+// they arrive, so a record's length never matters.
+class FastaStreamSplitter {
+private:
+    static constexpr size_t MAX_HEADER_BYTES = 64 << 10;
+
+public:
+    // onSequence(bytes) for the raw body of the current record, line breaks
+    // included, in as many pieces as it arrives; onRecordEnd(name) when the
+    // record ends, for records without sequence too. stop() is polled
+    // between pieces of input, returning true ends the run early.
+    template <typename OnSequence, typename OnRecordEnd, typename Stop>
+    void run(ByteStream& in, OnSequence&& onSequence, OnRecordEnd&& onRecordEnd, Stop&& stop) {
+        std::string header;
+        bool lineStart = true;
+        bool inHeader = false;
+
+        auto finishRecord = [&]() {
+            if (!header.empty() && header.back() == '\r') header.pop_back();
+            std::string_view name(header);
+            onRecordEnd(name.substr(0, name.find(' ')));
+        };
+
+        while (!stop()) {
+            std::string_view piece = in.next();
+            if (piece.empty()) break;
+            const char* p = piece.data();
+            const char* end = p + piece.size();
+
+            while (p < end) {
+                if (inHeader) {
+                    const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+                    const char* stopAt = eol ? eol : end;
+                    size_t room = MAX_HEADER_BYTES - std::min(MAX_HEADER_BYTES, header.size());
+                    header.append(p, std::min(room, static_cast<size_t>(stopAt - p)));
+                    if (eol == nullptr) {
+                        p = end;
+                        break;
+                    }
+                    inHeader = false;
+                    lineStart = true;
+                    p = eol + 1;
+                    continue;
+                }
+
+                if (lineStart && *p == '>') {
+                    finishRecord();
+                    header.clear();
+                    inHeader = true;
+                    ++p;
+                    continue;
+                }
+
+                // Sequence up to the next '>' that starts a line; whether the
+                // piece itself starts a line was carried in from the last one
+                const char* q = p;
+                while (true) {
+                    q = static_cast<const char*>(std::memchr(q, '>', end - q));
+                    if (q == nullptr || (q == p ? lineStart : q[-1] == '\n')) break;
+                    ++q;
+                }
+                const char* bodyEnd = q ? q : end;
+                onSequence(std::string_view(p, bodyEnd - p));
+                lineStart = bodyEnd > p ? bodyEnd[-1] == '\n' : lineStart;
+                p = bodyEnd;
+            }
+        }
+        finishRecord();
+    }
+};
+
+// Per-record GC counts of a FASTA byte stream in fixed memory, counted piece
+// by piece as the input arrives; records without sequence are skipped
+class StreamingGCCounter {
+public:
+    // onRecord(name, counts) for every non-empty record in order; stop() is
+    // polled between pieces of input, returning true ends the run early
+    template <typename OnRecord, typename Stop>
+    void run(ByteStream& in, OnRecord&& onRecord, Stop&& stop) {
+        GCCounts counts;
+        FastaStreamSplitter().run(in,
+            [&](std::string_view bytes) { counts += countGC(bytes.data(), bytes.size()); },
+            [&](std::string_view name) {
+                if (counts.length != 0) {  // no sequence data otherwise
+                    onRecord(name, static_cast<const GCCounts&>(counts));
+                }
+                counts = GCCounts();
+            },
+            stop);
+    }
+
+    template <typename OnRecord>
+    void run(ByteStream& in, OnRecord&& onRecord) {
+        run(in, std::forward<OnRecord>(onRecord), [] { return false; });
+    }
+};
+
+#endif
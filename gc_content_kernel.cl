@@ -1,19 +1,71 @@
-__kernel void gc_count(
-    __global const char* dna_sequence, 
-    __global int* gc_counts, 
-    const int sequence_length) {
-    // Get thread ID
-    int thread_id = get_global_id(0);
-    int local_gc_count = 0;
+// GC counting kernel of GCCalculator in gc_opencl.hpp (embedded at build
+// time through gc_content_kernel.inc, see the Makefile).
+//
+// A batch holds raw record bodies back to back, line breaks included. The
+// host cuts it into spans that never cross a record boundary; span g is
+// sequence[spans[g] .. spans[g + 1]) and is counted by work-group g. Each
+// work-item reads 16 bytes at a time with a stride of the group size, so
+// neighbouring work-items touch neighbouring memory. Per-item counts are
+// summed in local memory and the group writes one set of 64-bit partial
+// sums per span, matching GCCounts: partials[3g] = GC, partials[3g + 1] = N,
+// partials[3g + 2] = length without line breaks. The host adds the partials
+// of a record's spans; no global atomics are used.
 
-    // Each thread processes a chunk of the DNA sequence
-    for (int i = thread_id; i < sequence_length; i += get_global_size(0)) {
-        char base = dna_sequence[i];
-        if (base == 'G' || base == 'C') {
-            local_gc_count++;
+// Number of lanes set in a comparison mask (lanes are 0 or -1)
+uint countLanes(char16 mask) {
+    uchar16 ones = as_uchar16(mask) & (uchar16)(1);
+    uchar8 s8 = ones.lo + ones.hi;
+    uchar4 s4 = s8.lo + s8.hi;
+    uchar2 s2 = s4.lo + s4.hi;
+    return s2.s0 + s2.s1;
+}
+
+__kernel void countGC(__global const char* sequence,
+                      __global const uint* spans,
+                      __global ulong* partials,
+                      __local uint* scratchGC,
+                      __local uint* scratchN,
+                      __local uint* scratchBreaks) {
+    uint group = get_group_id(0);
+    uint lid = get_local_id(0);
+    uint size = get_local_size(0);
+    uint start = spans[group];
+    uint end = spans[group + 1];
+    uint vectorEnd = start + (end - start) / 16 * 16;
+
+    uint gc = 0, n = 0, breaks = 0;
+    for (uint p = start + lid * 16; p < vectorEnd; p += size * 16) {
+        char16 v = vload16(0, sequence + p);
+        char16 upper = v & (char16)(0xDF);  // fold lower case; keeps '\n' and '\r'
+        gc += countLanes((upper == (char16)('G')) | (upper == (char16)('C')));
+        n += countLanes(upper == (char16)('N'));
+        breaks += countLanes((v == (char16)('\n')) | (v == (char16)('\r')));
+    }
+    for (uint p = vectorEnd + lid; p < end; p += size) {
+        char base = sequence[p];
+        char upper = base & 0xDF;
+        gc += (upper == 'G' || upper == 'C');
+        n += (upper == 'N');
+        breaks += (base == '\n' || base == '\r');
+    }
+
+    // Tree reduction; the group size is a power of two
+    scratchGC[lid] = gc;
+    scratchN[lid] = n;
+    scratchBreaks[lid] = breaks;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (uint half = size / 2; half > 0; half /= 2) {
+        if (lid < half) {
+            scratchGC[lid] += scratchGC[lid + half];
+            scratchN[lid] += scratchN[lid + half];
+            scratchBreaks[lid] += scratchBreaks[lid + half];
         }
+        barrier(CLK_LOCAL_MEM_FENCE);
     }
 
-    // Store the result in the output array
-    gc_counts[thread_id] = local_gc_count;
+    if (lid == 0) {
+        partials[3 * group] = scratchGC[0];
+        partials[3 * group + 1] = scratchN[0];
+        partials[3 * group + 2] = (ulong)(end - start) - scratchBreaks[0];
+    }
 }
@@ -0,0 +1,221 @@
+#ifndef GC_COUNTER_HPP
+#define GC_COUNTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define GC_COUNTER_X86 1
+#include <immintrin.h>
+#endif
+
+// Base counts for a stretch of FASTA sequence data. Upper and lower case
+// (soft-masked) bases are treated alike; '\n' and '\r' are not bases, so a
+// raw multi-line record body can be counted in one call.
+struct GCCounts {
+    uint64_t gc = 0;      // G, C, g, c
+    uint64_t n = 0;       // N, n
+    uint64_t length = 0;  // all sequence characters, line breaks excluded
+
+    // Bases other than N, the denominator of the GC percentage
+    uint64_t bases() const { return length - n; }
+
+    GCCounts& operator+=(const GCCounts& other) {
+        gc += other.gc;
+        n += other.n;
+        length += other.length;
+        return *this;
+    }
+};
+
+enum class GCKernel { Scalar, SSE42, AVX2, AVX512 };
+
+inline const char* gcKernelName(GCKernel kernel) {
+    switch (kernel) {
+        case GCKernel::SSE42: return "sse4.2";
+        case GCKernel::AVX2: return "avx2";
+        case GCKernel::AVX512: return "avx512bw";
+        default: return "scalar";
+    }
+}
+
+// Portable fallback. OR-ing 0x20 folds upper case onto lower case; no other
+// byte lands on 'g', 'c' or 'n' that way.
+inline GCCounts countGCScalar(const char* data, size_t size) {
+    uint64_t gc = 0, n = 0, breaks = 0;
+    for (size_t i = 0; i < size; ++i) {
+        char base = data[i];
+        char lower = static_cast<char>(base | 0x20);
+        gc += (lower == 'g') | (lower == 'c');
+        n += (lower == 'n');
+        breaks += (base == '\n') | (base == '\r');
+    }
+    GCCounts counts;
+    counts.gc = gc;
+    counts.n = n;
+    counts.length = size - breaks;
+    return counts;
+}
+
+#ifdef GC_COUNTER_X86
+
+// The SSE and AVX2 kernels keep per-byte counters (subtracting a 0xFF compare
+// mask adds one) and fold them into 64-bit sums with SAD every 255 vectors,
+// before the 8-bit lanes can wrap.
+__attribute__((target("sse4.2")))
+inline GCCounts countGCSSE42(const char* data, size_t size) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i g = _mm_set1_epi8('g');
+    const __m128i c = _mm_set1_epi8('c');
+    const __m128i n = _mm_set1_epi8('n');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+
+    __m128i gcSum = zero, nSum = zero, breakSum = zero;
+    size_t i = 0;
+    while (size - i >= 16) {
+        size_t vectors = std::min<size_t>((size - i) / 16, 255);
+        __m128i gc8 = zero, n8 = zero, break8 = zero;
+        for (size_t k = 0; k < vectors; ++k, i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            __m128i lower = _mm_or_si128(v, caseBit);
+            gc8 = _mm_sub_epi8(gc8, _mm_or_si128(_mm_cmpeq_epi8(lower, g), _mm_cmpeq_epi8(lower, c)));
+            n8 = _mm_sub_epi8(n8, _mm_cmpeq_epi8(lower, n));
+            break8 = _mm_sub_epi8(break8, _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+        }
+        gcSum = _mm_add_epi64(gcSum, _mm_sad_epu8(gc8, zero));
+        nSum = _mm_add_epi64(nSum, _mm_sad_epu8(n8, zero));
+        breakSum = _mm_add_epi64(breakSum, _mm_sad_epu8(break8, zero));
+    }
+
+    GCCounts counts = countGCScalar(data + i, size - i);
+    counts.gc += _mm_cvtsi128_si64(gcSum) + _mm_extract_epi64(gcSum, 1);
+    counts.n += _mm_cvtsi128_si64(nSum) + _mm_extract_epi64(nSum, 1);
+    counts.length += i - (_mm_cvtsi128_si64(breakSum) + _mm_extract_epi64(breakSum, 1));
+    return counts;
+}
+
+__attribute__((target("avx2")))
+inline uint64_t sumLanesAVX2(__m256i v) {
+    __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return _mm_cvtsi128_si64(sum) + _mm_extract_epi64(sum, 1);
+}
+
+__attribute__((target("avx2")))
+inline GCCounts countGCAVX2(const char* data, size_t size) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    const __m256i g = _mm256_set1_epi8('g');
+    const __m256i c = _mm256_set1_epi8('c');
+    const __m256i n = _mm256_set1_epi8('n');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+
+    __m256i gcSum = zero, nSum = zero, breakSum = zero;
+    size_t i = 0;
+    while (size - i >= 32) {
+        size_t vectors = std::min<size_t>((size - i) / 32, 255);
+        __m256i gc8 = zero, n8 = zero, break8 = zero;
+        for (size_t k = 0; k < vectors; ++k, i += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            __m256i lower = _mm256_or_si256(v, caseBit);
+            gc8 = _mm256_sub_epi8(gc8, _mm256_or_si256(_mm256_cmpeq_epi8(lower, g), _mm256_cmpeq_epi8(lower, c)));
+            n8 = _mm256_sub_epi8(n8, _mm256_cmpeq_epi8(lower, n));
+            break8 = _mm256_sub_epi8(break8, _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr)));
+        }
+        gcSum = _mm256_add_epi64(gcSum, _mm256_sad_epu8(gc8, zero));
+        nSum = _mm256_add_epi64(nSum, _mm256_sad_epu8(n8, zero));
+        breakSum = _mm256_add_epi64(breakSum, _mm256_sad_epu8(break8, zero));
+    }
+
+    GCCounts counts = countGCScalar(data + i, size - i);
+    counts.gc += sumLanesAVX2(gcSum);
+    counts.n += sumLanesAVX2(nSum);
+    counts.length += i - sumLanesAVX2(breakSum);
+    return counts;
+}
+
+// AVX-512BW compares straight into 64-bit masks, so counting is a popcount
+// and the tail is a masked load instead of a scalar loop.
+__attribute__((target("avx512bw,popcnt")))
+inline void countBlockAVX512(__m512i v, __mmask64 valid, GCCounts& counts, uint64_t& breaks) {
+    const __m512i lower = _mm512_or_si512(v, _mm512_set1_epi8(0x20));
+    __mmask64 gcMask = _mm512_mask_cmpeq_epi8_mask(valid, lower, _mm512_set1_epi8('g')) |
+                       _mm512_mask_cmpeq_epi8_mask(valid, lower, _mm512_set1_epi8('c'));
+    __mmask64 nMask = _mm512_mask_cmpeq_epi8_mask(valid, lower, _mm512_set1_epi8('n'));
+    __mmask64 breakMask = _mm512_mask_cmpeq_epi8_mask(valid, v, _mm512_set1_epi8('\n')) |
+                          _mm512_mask_cmpeq_epi8_mask(valid, v, _mm512_set1_epi8('\r'));
+    counts.gc += _mm_popcnt_u64(gcMask);
+    counts.n += _mm_popcnt_u64(nMask);
+    breaks += _mm_popcnt_u64(breakMask);
+}
+
+__attribute__((target("avx512bw,popcnt")))
+inline GCCounts countGCAVX512(const char* data, size_t size) {
+    GCCounts counts;
+    uint64_t breaks = 0;
+    size_t i = 0;
+    for (; size - i >= 64; i += 64) {
+        countBlockAVX512(_mm512_loadu_si512(data + i), ~0ULL, counts, breaks);
+    }
+    if (i < size) {
+        __mmask64 valid = (1ULL << (size - i)) - 1;
+        countBlockAVX512(_mm512_maskz_loadu_epi8(valid, data + i), valid, counts, breaks);
+    }
+    counts.length = size - breaks;
+    return counts;
+}
+
+#endif
+
+using GCCountFunction = GCCounts (*)(const char*, size_t);
+
+// Whether this CPU can run the given kernel
+inline bool gcKernelSupported(GCKernel kernel) {
+#ifdef GC_COUNTER_X86
+    __builtin_cpu_init();
+    switch (kernel) {
+        case GCKernel::SSE42: return __builtin_cpu_supports("sse4.2");
+        case GCKernel::AVX2: return __builtin_cpu_supports("avx2");
+        case GCKernel::AVX512: return __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("popcnt");
+        default: return true;
+    }
+#else
+    return kernel == GCKernel::Scalar;
+#endif
+}
+
+inline GCCountFunction gcKernelFunction(GCKernel kernel) {
+#ifdef GC_COUNTER_X86
+    switch (kernel) {
+        case GCKernel::SSE42: return countGCSSE42;
+        case GCKernel::AVX2: return countGCAVX2;
+        case GCKernel::AVX512: return countGCAVX512;
+        default: break;
+    }
+#endif
+    (void)kernel;
+    return countGCScalar;
+}
+
+// Widest kernel the CPU supports, probed once via CPUID
+inline GCKernel bestGCKernel() {
+    static const GCKernel best = [] {
+        const GCKernel order[] = {GCKernel::AVX512, GCKernel::AVX2, GCKernel::SSE42};
+        for (GCKernel kernel : order) {
+            if (gcKernelSupported(kernel)) return kernel;
+        }
+        return GCKernel::Scalar;
+    }();
+    return best;
+}
+
+// Count GC, N and sequence length with the best kernel for this CPU
+inline GCCounts countGC(const char* data, size_t size) {
+    static const GCCountFunction kernel = gcKernelFunction(bestGCKernel());
+    return kernel(data, size);
+}
+
+#endif
@@ -0,0 +1,300 @@
+#ifndef GC_OPENCL_HPP
+#define GC_OPENCL_HPP
+
+#define CL_HPP_TARGET_OPENCL_VERSION 120
+#define CL_HPP_MINIMUM_OPENCL_VERSION 120
+#define CL_HPP_ENABLE_EXCEPTIONS
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <CL/opencl.hpp>
+#include "fasta_reader.hpp"
+#include "gc_counter.hpp"
+
+// Work-group reduction kernel from gc_content_kernel.cl, wrapped in a raw
+// string literal by the Makefile
+inline const char* gcKernelSource() {
+    return
+#include "gc_content_kernel.inc"
+    ;
+}
+
+// Which kind of OpenCL device to run on
+enum class DeviceChoice { Any, GPU, CPU };
+
+// OpenCL GC counter that keeps its context, program and buffers for the
+// whole run. Byte ranges (record bodies or chunks of them) are copied back
+// to back into one of two pinned staging buffers; a full batch is uploaded
+// and counted with a single kernel launch while the next batch is filled
+// into the other buffer, so the host never waits on the device except to
+// collect a batch submitted one step earlier. Each range is cut into spans
+// of at most SPAN_BYTES, one per work-group; the 64-bit partial sums of a
+// range's spans (and of its pieces, when a range is larger than a batch)
+// are added up on the host.
+class GCCalculator {
+private:
+    static constexpr size_t DEFAULT_BATCH_BYTES = 16 << 20;
+    static constexpr size_t MAX_BATCH_RANGES = 1 << 16;
+    static constexpr size_t SPAN_BYTES = 64 << 10;
+    static constexpr size_t MAX_GROUP_SIZE = 256;
+
+    // Part of a range placed in a batch
+    struct BatchPiece {
+        size_t range;
+        bool last;  // final piece of the range
+    };
+
+    struct BatchSlot {
+        cl::Buffer pinned;           // host-visible staging memory (CL_MEM_ALLOC_HOST_PTR)
+        char* staging = nullptr;     // pinned, mapped for the calculator's lifetime
+        cl::Buffer sequence;         // device copy of the staging bytes
+        cl::Buffer spans;            // span start offsets, then the end of the batch
+        cl::Buffer partials;         // GC, N and length of every span
+        std::vector<cl_uint> hostSpans;
+        std::vector<size_t> spanPiece;  // piece each span belongs to
+        std::vector<cl_ulong> hostPartials;
+        std::vector<BatchPiece> pieces;
+        size_t used = 0;
+        bool inFlight = false;
+        cl::Event done;              // partials read back
+    };
+
+    cl::Context context;
+    cl::CommandQueue queue;
+    cl::Program program;
+    cl::Kernel kernel;
+    cl::Device device;
+    size_t batchBytes;
+    size_t maxSpans;   // spans a full batch of MAX_BATCH_RANGES pieces can need
+    size_t groupSize;  // power of two
+    BatchSlot slots[2];
+    size_t current = 0;     // slot being filled
+    size_t nextRange = 0;   // index given to the next added range
+    GCCounts partial;       // sums of the pieces of a range split across batches
+
+    static std::vector<cl::Device> devicesOfType(cl_device_type type) {
+        std::vector<cl::Platform> platforms;
+        try {
+            cl::Platform::get(&platforms);
+        } catch (const std::exception&) {
+            return {};  // no ICD loader or no platform installed
+        }
+        std::vector<cl::Device> found;
+        for (cl::Platform& platform : platforms) {
+            std::vector<cl::Device> devices;
+            try {
+                platform.getDevices(type, &devices);
+            } catch (const std::exception&) {
+                continue;  // CL_DEVICE_NOT_FOUND on this platform
+            }
+            found.insert(found.end(), devices.begin(), devices.end());
+        }
+        return found;
+    }
+
+    // First device of the requested kind across all platforms; Any prefers a
+    // GPU and falls back to whatever is there (e.g. pocl's CPU device)
+    static cl::Device selectDevice(DeviceChoice choice) {
+        std::vector<cl::Device> devices;
+        if (choice != DeviceChoice::CPU) devices = devicesOfType(CL_DEVICE_TYPE_GPU);
+        if (devices.empty() && choice == DeviceChoice::CPU) devices = devicesOfType(CL_DEVICE_TYPE_CPU);
+        if (devices.empty() && choice == DeviceChoice::Any) devices = devicesOfType(CL_DEVICE_TYPE_ALL);
+        if (devices.empty()) {
+            throw std::runtime_error(choice == DeviceChoice::GPU ? "No GPU devices found"
+                                     : choice == DeviceChoice::CPU ? "No CPU devices found"
+                                     : "No OpenCL devices found");
+        }
+        return devices[0];
+    }
+
+    void initializeOpenCL(size_t batch) {
+        context = cl::Context(device);
+        queue = cl::CommandQueue(context, device);
+
+        cl::Program::Sources sources;
+        const char* source = gcKernelSource();
+        sources.push_back({source, strlen(source)});
+        program = cl::Program(context, sources);
+
+        try {
+            program.build({device});
+        } catch (const std::exception& e) {
+            std::cerr << "Build error: " << program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device) << std::endl;
+            throw;
+        }
+
+        kernel = cl::Kernel(program, "countGC");
+
+        // The local reduction halves the group each step
+        size_t limit = std::min(MAX_GROUP_SIZE, kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device));
+        groupSize = 1;
+        while (groupSize * 2 <= limit) groupSize *= 2;
+
+        batchBytes = batch == 0 ? DEFAULT_BATCH_BYTES : batch;
+        size_t maxAlloc = static_cast<size_t>(device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>());
+        batchBytes = std::min({batchBytes, maxAlloc, static_cast<size_t>(INT32_MAX)});
+        maxSpans = batchBytes / SPAN_BYTES + MAX_BATCH_RANGES;
+        allocateSlots();
+    }
+
+    void allocateSlots() {
+        for (BatchSlot& slot : slots) {
+            slot.pinned = cl::Buffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, batchBytes);
+            slot.staging = static_cast<char*>(
+                queue.enqueueMapBuffer(slot.pinned, CL_TRUE, CL_MAP_WRITE, 0, batchBytes));
+            slot.sequence = cl::Buffer(context, CL_MEM_READ_ONLY, batchBytes);
+            slot.spans = cl::Buffer(context, CL_MEM_READ_ONLY, (maxSpans + 1) * sizeof(cl_uint));
+            slot.partials = cl::Buffer(context, CL_MEM_WRITE_ONLY, 3 * maxSpans * sizeof(cl_ulong));
+            slot.hostSpans.reserve(maxSpans + 1);
+            slot.spanPiece.reserve(maxSpans);
+            slot.pieces.reserve(MAX_BATCH_RANGES);
+        }
+    }
+
+    // Queue upload, count and read-back of a slot without waiting for any of it
+    void submit(BatchSlot& slot) {
+        if (slot.pieces.empty()) return;
+        slot.inFlight = true;
+        size_t groups = slot.spanPiece.size();
+        if (groups == 0) return;  // only empty ranges
+        slot.hostSpans.push_back(static_cast<cl_uint>(slot.used));
+        slot.hostPartials.resize(3 * groups);
+
+        queue.enqueueWriteBuffer(slot.sequence, CL_FALSE, 0, slot.used, slot.staging);
+        queue.enqueueWriteBuffer(slot.spans, CL_FALSE, 0, slot.hostSpans.size() * sizeof(cl_uint),
+                                 slot.hostSpans.data());
+
+        kernel.setArg(0, slot.sequence);
+        kernel.setArg(1, slot.spans);
+        kernel.setArg(2, slot.partials);
+        kernel.setArg(3, cl::Local(groupSize * sizeof(cl_uint)));
+        kernel.setArg(4, cl::Local(groupSize * sizeof(cl_uint)));
+        kernel.setArg(5, cl::Local(groupSize * sizeof(cl_uint)));
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(groups * groupSize), cl::NDRange(groupSize));
+
+        queue.enqueueReadBuffer(slot.partials, CL_FALSE, 0, 3 * groups * sizeof(cl_ulong),
+                                slot.hostPartials.data(), nullptr, &slot.done);
+        queue.flush();
+    }
+
+    // Wait for a submitted slot, report its finished ranges and empty it
+    template <typename OnRange>
+    void collect(BatchSlot& slot, OnRange& onRange) {
+        if (slot.inFlight) {
+            if (!slot.spanPiece.empty()) slot.done.wait();
+            size_t span = 0;
+            for (size_t k = 0; k < slot.pieces.size(); ++k) {
+                for (; span < slot.spanPiece.size() && slot.spanPiece[span] == k; ++span) {
+                    partial.gc += slot.hostPartials[3 * span];
+                    partial.n += slot.hostPartials[3 * span + 1];
+                    partial.length += slot.hostPartials[3 * span + 2];
+                }
+                if (slot.pieces[k].last) {
+                    onRange(slot.pieces[k].range, static_cast<const GCCounts&>(partial));
+                    partial = GCCounts();
+                }
+            }
+            slot.inFlight = false;
+        }
+        slot.pieces.clear();
+        slot.hostSpans.clear();
+        slot.spanPiece.clear();
+        slot.used = 0;
+    }
+
+public:
+    // batch == 0 uses the default; the size is capped by the device's largest allocation
+    explicit GCCalculator(DeviceChoice choice = DeviceChoice::Any, size_t batch = 0)
+        : device(selectDevice(choice)) {
+        initializeOpenCL(batch);
+    }
+
+    explicit GCCalculator(const cl::Device& target, size_t batch = 0) : device(target) {
+        initializeOpenCL(batch);
+    }
+
+    ~GCCalculator() {
+        try {
+            queue.finish();
+            for (BatchSlot& slot : slots) {
+                if (slot.staging != nullptr) queue.enqueueUnmapMemObject(slot.pinned, slot.staging);
+            }
+            queue.finish();
+        } catch (const std::exception&) {
+            // Nothing useful to do while tearing down
+        }
+    }
+
+    GCCalculator(const GCCalculator&) = delete;
+    GCCalculator& operator=(const GCCalculator&) = delete;
+
+    // Every device of every platform; empty when OpenCL is not installed
+    static std::vector<cl::Device> allDevices() { return devicesOfType(CL_DEVICE_TYPE_ALL); }
+
+    std::string deviceName() const { return device.getInfo<CL_DEVICE_NAME>(); }
+
+    bool isCpuDevice() const { return (device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_CPU) != 0; }
+
+    // Copy range into the current batch and return its index (0, 1, ... in
+    // call order). onRange(index, counts) is called in index order as batches
+    // complete, one batch behind the adding, and at the latest by finish().
+    template <typename OnRange>
+    size_t add(std::string_view range, OnRange& onRange) {
+        size_t index = nextRange++;
+        do {
+            BatchSlot* slot = &slots[current];
+            if (slot->used == batchBytes || slot->pieces.size() == MAX_BATCH_RANGES) {
+                submit(*slot);
+                current ^= 1;
+                slot = &slots[current];
+                collect(*slot, onRange);  // the batch before, done by now or soon
+            }
+            size_t take = std::min(range.size(), batchBytes - slot->used);
+            std::memcpy(slot->staging + slot->used, range.data(), take);
+            slot->pieces.push_back({index, take == range.size()});
+            for (size_t offset = 0; offset < take; offset += SPAN_BYTES) {
+                slot->hostSpans.push_back(static_cast<cl_uint>(slot->used + offset));
+                slot->spanPiece.push_back(slot->pieces.size() - 1);
+            }
+            slot->used += take;
+            range.remove_prefix(take);
+        } while (!range.empty());
+        return index;
+    }
+
+    // Count everything added so far and report it
+    template <typename OnRange>
+    void finish(OnRange& onRange) {
+        submit(slots[current]);
+        collect(slots[current ^ 1], onRange);
+        collect(slots[current], onRange);
+    }
+
+    // Count every non-empty record of reader. onRecord(record, number, counts)
+    // is called in file order, one batch behind the parsing.
+    template <typename OnRecord>
+    void run(FastaReader& reader, OnRecord&& onRecord) {
+        std::deque<std::pair<FastaRecord, int>> pending;  // added, not yet reported
+        auto onRange = [&](size_t, const GCCounts& counts) {
+            onRecord(pending.front().first, pending.front().second, counts);
+            pending.pop_front();
+        };
+
+        FastaRecord record;
+        int sequenceNumber = 0;
+        while (reader.next(record)) {
+            // Records without any sequence data are not numbered
+            if (record.empty()) continue;
+            pending.emplace_back(record, sequenceNumber++);
+            add(record.body, onRange);
+        }
+        finish(onRange);
+    }
+};
+
+#endif
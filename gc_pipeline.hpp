@@ -0,0 +1,89 @@
+#ifndef GC_PIPELINE_HPP
+#define GC_PIPELINE_HPP
+
+#include <deque>
+#include <future>
+#include <vector>
+#include "fasta_reader.hpp"
+#include "gc_counter.hpp"
+#include "thread_pool.hpp"
+
+// Multi-threaded GC counting over a whole FASTA file. Record bodies are cut
+// into fixed-size chunks that are counted on a thread pool; per-record totals
+// are merged and reported in the original record order.
+class ParallelGCCounter {
+private:
+    struct PendingRecord {
+        FastaRecord record;
+        std::vector<std::future<GCCounts>> chunks;
+    };
+
+    ThreadPool pool;
+    size_t chunkSize;
+    size_t maxChunksInFlight;
+
+public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 4 << 20;  // 4 MiB of raw record body
+
+    // threads == 0 uses every hardware thread
+    explicit ParallelGCCounter(size_t threads = 0, size_t chunk = DEFAULT_CHUNK_SIZE)
+        : pool(threads), chunkSize(chunk == 0 ? DEFAULT_CHUNK_SIZE : chunk),
+          maxChunksInFlight(pool.size() * 4) {}
+
+    size_t threadCount() const { return pool.size(); }
+
+    // Count every non-empty record of reader. onRecord(record, counts) is called
+    // on the calling thread, in file order, as soon as a record is complete.
+    // stop() is polled between records; returning true ends the run early.
+    template <typename OnRecord, typename Stop>
+    void run(FastaReader& reader, OnRecord&& onRecord, Stop&& stop) {
+        std::deque<PendingRecord> pending;
+        size_t chunksInFlight = 0;
+
+        auto finishFront = [&]() {
+            PendingRecord& front = pending.front();
+            GCCounts counts;
+            for (std::future<GCCounts>& chunk : front.chunks) {
+                counts += chunk.get();
+            }
+            chunksInFlight -= front.chunks.size();
+            onRecord(front.record, counts);
+            pending.pop_front();
+        };
+
+        FastaRecord record;
+        while (!stop() && reader.next(record)) {
+            // Records without any sequence data are not numbered
+            if (record.empty()) continue;
+
+            PendingRecord entry;
+            entry.record = record;
+            const char* body = record.body.data();
+            size_t size = record.body.size();
+            for (size_t offset = 0; offset < size; offset += chunkSize) {
+                size_t length = std::min(chunkSize, size - offset);
+                entry.chunks.push_back(pool.submit([body, offset, length] {
+                    return countGC(body + offset, length);
+                }));
+            }
+            chunksInFlight += entry.chunks.size();
+            pending.push_back(std::move(entry));
+
+            // Keep the workers busy without queueing the whole genome at once
+            while (chunksInFlight > maxChunksInFlight && pending.size() > 1) {
+                finishFront();
+            }
+        }
+
+        while (!pending.empty()) {
+            finishFront();
+        }
+    }
+
+    template <typename OnRecord>
+    void run(FastaReader& reader, OnRecord&& onRecord) {
+        run(reader, std::forward<OnRecord>(onRecord), [] { return false; });
+    }
+};
+
+#endif
@@ -0,0 +1,235 @@
+#ifndef GC_SCHEDULER_HPP
+#define GC_SCHEDULER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <exception>
+#include <algorithm>
+#include <chrono>
+#include "gc_counter.hpp"
+#include "thread_pool.hpp"
+#ifdef GC_USE_OPENCL
+#include "gc_opencl.hpp"
+#endif
+
+// One way of counting GC over byte ranges of FASTA record bodies
+class GCBackend {
+public:
+    virtual ~GCBackend() = default;
+
+    virtual std::string name() const = 0;
+
+    // Whether the backend runs on the host's cores. Host backends compete for
+    // the same cores, so only the fastest of them is scheduled.
+    virtual bool usesHostCores() const = 0;
+
+    // counts[k] = counts of ranges[k] for k in [begin, end)
+    virtual void count(const std::vector<std::string_view>& ranges, size_t begin, size_t end,
+                       GCCounts* counts) = 0;
+};
+
+// One of the gc_counter.hpp kernels on the calling thread
+class KernelBackend : public GCBackend {
+private:
+    GCKernel kernel;
+    GCCountFunction function;
+
+public:
+    explicit KernelBackend(GCKernel k) : kernel(k), function(gcKernelFunction(k)) {}
+
+    std::string name() const override { return gcKernelName(kernel); }
+    bool usesHostCores() const override { return true; }
+
+    void count(const std::vector<std::string_view>& ranges, size_t begin, size_t end,
+               GCCounts* counts) override {
+        for (size_t k = begin; k < end; ++k) {
+            counts[k] = function(ranges[k].data(), ranges[k].size());
+        }
+    }
+};
+
+// The best SIMD kernel on every core; small ranges are grouped into tasks
+// of at least TASK_BYTES
+class ThreadedBackend : public GCBackend {
+private:
+    static constexpr size_t TASK_BYTES = 1 << 20;
+
+    ThreadPool pool;
+
+public:
+    // threads == 0 uses every hardware thread
+    explicit ThreadedBackend(size_t threads = 0) : pool(threads) {}
+
+    std::string name() const override { return "threads"; }
+    bool usesHostCores() const override { return true; }
+
+    void count(const std::vector<std::string_view>& ranges, size_t begin, size_t end,
+               GCCounts* counts) override {
+        std::vector<std::future<void>> tasks;
+        for (size_t first = begin; first < end;) {
+            size_t last = first, bytes = 0;
+            while (last < end && (last == first || bytes < TASK_BYTES)) bytes += ranges[last++].size();
+            tasks.push_back(pool.submit([&ranges, counts, first, last] {
+                for (size_t k = first; k < last; ++k) {
+                    counts[k] = countGC(ranges[k].data(), ranges[k].size());
+                }
+            }));
+            first = last;
+        }
+        for (std::future<void>& task : tasks) task.get();
+    }
+};
+
+#ifdef GC_USE_OPENCL
+// One OpenCL device through GCCalculator's batched kernel
+class OpenCLBackend : public GCBackend {
+private:
+    std::string label;
+    GCCalculator calculator;
+
+public:
+    OpenCLBackend(const cl::Device& device, size_t index)
+        : label("opencl:" + std::to_string(index)), calculator(device) {
+        label += " (" + calculator.deviceName() + ")";
+    }
+
+    std::string name() const override { return label; }
+
+    // A CPU OpenCL runtime (pocl) uses the same cores as the host backends
+    bool usesHostCores() const override { return calculator.isCpuDevice(); }
+
+    void count(const std::vector<std::string_view>& ranges, size_t begin, size_t end,
+               GCCounts* counts) override {
+        size_t first = 0;
+        auto onRange = [&](size_t index, const GCCounts& result) { counts[begin + index - first] = result; };
+        for (size_t k = begin; k < end; ++k) {
+            size_t index = calculator.add(ranges[k], onRange);
+            if (k == begin) first = index;
+        }
+        calculator.finish(onRange);
+    }
+};
+#endif
+
+// Splits GC counting across backends by measured throughput. profile() times
+// every backend on a sample; count() then runs the fastest host backend and
+// every device that does not share the host's cores side by side. Each one
+// repeatedly claims the next consecutive ranges worth CLAIM_SECONDS of its
+// measured throughput, so a fast GPU takes big blocks, a slow one small
+// blocks, and a misjudged backend costs at most one claim at the end.
+class GCScheduler {
+public:
+    struct Profile {
+        GCBackend* backend;
+        double bytesPerSecond = 0;
+        bool selected = false;
+        size_t bytesCounted = 0;  // by the last count()
+    };
+
+private:
+    static constexpr double CLAIM_SECONDS = 0.05;
+    static constexpr int PROFILE_RUNS = 3;
+
+    std::vector<std::unique_ptr<GCBackend>> backends;
+    std::vector<Profile> profiles;
+
+    static size_t totalBytes(const std::vector<std::string_view>& ranges) {
+        size_t total = 0;
+        for (std::string_view range : ranges) total += range.size();
+        return total;
+    }
+
+public:
+    void addBackend(std::unique_ptr<GCBackend> backend) {
+        profiles.push_back({backend.get()});
+        backends.push_back(std::move(backend));
+    }
+
+    const std::vector<Profile>& backendProfiles() const { return profiles; }
+
+    // Time every backend on sample (after one warm-up run, best of
+    // PROFILE_RUNS) and select the ones count() will use
+    void profile(const std::vector<std::string_view>& sample) {
+        if (backends.empty()) {
+            throw std::runtime_error("No GC backends available");
+        }
+        double bytes = static_cast<double>(std::max<size_t>(totalBytes(sample), 1));
+        std::vector<GCCounts> counts(sample.size());
+        for (Profile& entry : profiles) {
+            entry.backend->count(sample, 0, sample.size(), counts.data());
+            double best = 0;
+            for (int run = 0; run < PROFILE_RUNS; ++run) {
+                auto start = std::chrono::steady_clock::now();
+                entry.backend->count(sample, 0, sample.size(), counts.data());
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                if (run == 0 || seconds < best) best = seconds;
+            }
+            entry.bytesPerSecond = bytes / std::max(best, 1e-9);
+        }
+
+        Profile* fastestHost = nullptr;
+        for (Profile& entry : profiles) {
+            entry.selected = !entry.backend->usesHostCores();
+            if (entry.backend->usesHostCores() &&
+                (fastestHost == nullptr || entry.bytesPerSecond > fastestHost->bytesPerSecond)) {
+                fastestHost = &entry;
+            }
+        }
+        if (fastestHost != nullptr) fastestHost->selected = true;
+    }
+
+    // Counts of every range, each backend pulling blocks sized to its throughput
+    std::vector<GCCounts> count(const std::vector<std::string_view>& ranges) {
+        std::vector<GCCounts> counts(ranges.size());
+        std::mutex mutex;
+        size_t next = 0;
+
+        // Claim the next ranges worth about budget bytes, at least one;
+        // false once every range is taken
+        auto claim = [&](double budget, size_t& begin, size_t& end, size_t& bytes) {
+            std::lock_guard<std::mutex> lock(mutex);
+            begin = end = next;
+            bytes = 0;
+            while (end < ranges.size() && (end == begin || bytes + ranges[end].size() <= budget)) {
+                bytes += ranges[end++].size();
+            }
+            next = end;
+            return end > begin;
+        };
+
+        std::vector<std::thread> workers;
+        std::vector<std::exception_ptr> errors(profiles.size());
+        for (size_t b = 0; b < profiles.size(); ++b) {
+            Profile& entry = profiles[b];
+            entry.bytesCounted = 0;
+            if (!entry.selected) continue;
+            workers.emplace_back([&, b] {
+                Profile& self = profiles[b];
+                try {
+                    double budget = self.bytesPerSecond * CLAIM_SECONDS;
+                    size_t begin, end, bytes;
+                    while (claim(budget, begin, end, bytes)) {
+                        self.backend->count(ranges, begin, end, counts.data());
+                        self.bytesCounted += bytes;
+                    }
+                } catch (...) {
+                    errors[b] = std::current_exception();
+                    std::lock_guard<std::mutex> lock(mutex);
+                    next = ranges.size();  // stop the others too
+                }
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+        for (std::exception_ptr& error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+        return counts;
+    }
+};
+
+#endif
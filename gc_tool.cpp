@@ -0,0 +1,165 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <sstream>
+#include <cstdlib>
+#include "fasta_reader.hpp"
+#include "gc_counter.hpp"
+#include "gc_scheduler.hpp"
+
+// GC counter that spreads one file over every available backend: the scalar
+// and best SIMD kernels, the SIMD kernel on a thread pool and, when built
+// with OpenCL (GC_USE_OPENCL), every OpenCL device including CPU runtimes
+// such as pocl. Without OpenCL, or with no device installed, it runs on the
+// CPU backends alone.
+
+const size_t CHUNK_BYTES = 4 << 20;  // records are cut into ranges of at most this much
+
+// A record and the ranges [firstRange, endRange) its body was cut into
+struct RecordRanges {
+    FastaRecord record;
+    size_t firstRange;
+    size_t endRange;
+};
+
+// Whether name was asked for; a requested token matches every backend name
+// it is a prefix of ("opencl" selects all devices, "opencl:1" one of them)
+bool backendWanted(const std::vector<std::string>& wanted, const std::string& name) {
+    if (wanted.empty()) return true;
+    for (const std::string& token : wanted) {
+        if (name.compare(0, token.size(), token) == 0) return true;
+    }
+    return false;
+}
+
+void addBackends(GCScheduler& scheduler, const std::vector<std::string>& wanted, size_t threads) {
+    auto offer = [&](std::unique_ptr<GCBackend> backend) {
+        if (backendWanted(wanted, backend->name())) scheduler.addBackend(std::move(backend));
+    };
+
+    offer(std::make_unique<KernelBackend>(GCKernel::Scalar));
+    if (bestGCKernel() != GCKernel::Scalar) {
+        offer(std::make_unique<KernelBackend>(bestGCKernel()));
+    }
+    offer(std::make_unique<ThreadedBackend>(threads));
+
+#ifdef GC_USE_OPENCL
+    std::vector<cl::Device> devices = GCCalculator::allDevices();
+    for (size_t k = 0; k < devices.size(); ++k) {
+        if (!backendWanted(wanted, "opencl:" + std::to_string(k))) continue;
+        try {
+            scheduler.addBackend(std::make_unique<OpenCLBackend>(devices[k], k));
+        } catch (const std::exception& e) {
+            std::cerr << "Skipping OpenCL device " << k << ": " << e.what() << std::endl;
+        }
+    }
+#endif
+}
+
+void processFile(const std::string& filename, const std::vector<std::string>& wanted, size_t threads,
+                 size_t profileBytes) {
+    FastaReader reader(filename);
+    FastaRecord record;
+    std::vector<RecordRanges> records;
+    std::vector<std::string_view> ranges;
+
+    while (reader.next(record)) {
+        // Records without any sequence data are not numbered
+        if (record.empty()) continue;
+        RecordRanges entry{record, ranges.size(), 0};
+        for (size_t offset = 0; offset < record.body.size(); offset += CHUNK_BYTES) {
+            ranges.push_back(record.body.substr(offset, CHUNK_BYTES));
+        }
+        entry.endRange = ranges.size();
+        records.push_back(entry);
+    }
+
+    GCScheduler scheduler;
+    addBackends(scheduler, wanted, threads);
+
+    // Profile on the leading ranges of the file
+    std::vector<std::string_view> sample;
+    size_t sampled = 0;
+    for (size_t k = 0; k < ranges.size() && sampled < profileBytes; ++k) {
+        sample.push_back(ranges[k].substr(0, profileBytes - sampled));
+        sampled += sample.back().size();
+    }
+    scheduler.profile(sample);
+
+    std::vector<GCCounts> counts = scheduler.count(ranges);
+
+    for (const GCScheduler::Profile& entry : scheduler.backendProfiles()) {
+        std::cerr << std::left << std::setw(32) << entry.backend->name() << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(8) << entry.bytesPerSecond / 1e9 << " GB/s  "
+                  << (entry.selected ? "used, " + std::to_string(entry.bytesCounted) + " bytes" : "not used")
+                  << std::endl;
+    }
+    std::cerr << std::defaultfloat;
+
+    for (size_t r = 0; r < records.size(); ++r) {
+        GCCounts total;
+        for (size_t k = records[r].firstRange; k < records[r].endRange; ++k) total += counts[k];
+        if (total.bases() == 0) {
+            std::cout << "Warning: Empty sequence found, skipping." << std::endl;
+            continue;
+        }
+        float gcPercentage = (static_cast<float>(total.gc) / total.bases()) * 100.0f;
+        std::cout << "Sequence " << r << " (" << records[r].record.name() << "):\n"
+                  << "GC count: " << total.gc << "\n"
+                  << "Percentage: " << gcPercentage << "%\n";
+    }
+    std::cout.flush();
+}
+
+int main(int argc, char* argv[]) {
+    std::string filename;
+    std::vector<std::string> wanted;
+    size_t threads = 0;
+    size_t profileBytes = 8 << 20;
+    bool usage = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-t" || arg == "--threads") && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);  // 0 = all cores
+        } else if (arg == "--backends" && i + 1 < argc) {
+            std::stringstream list(argv[++i]);
+            std::string token;
+            while (std::getline(list, token, ',')) {
+                if (!token.empty()) wanted.push_back(token);
+            }
+        } else if (arg == "--profile-size" && i + 1 < argc) {
+            profileBytes = std::max<size_t>(std::strtoull(argv[++i], nullptr, 10) << 20, 1);  // MiB
+        } else if (filename.empty()) {
+            filename = arg;
+        } else {
+            usage = true;
+        }
+    }
+
+    if (usage || filename.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [-t <threads>] [--backends <list>] [--profile-size <MiB>] <FASTA file>" << std::endl;
+        std::cerr << "  -t, --threads N     threads of the thread-pool backend (0 = all cores)" << std::endl;
+        std::cerr << "  --backends LIST     comma-separated backends to consider: scalar, "
+                  << gcKernelName(bestGCKernel()) << ", threads"
+#ifdef GC_USE_OPENCL
+                  << ", opencl (every device) or opencl:N"
+#endif
+                  << std::endl;
+        std::cerr << "  --profile-size MiB  input used to measure each backend at startup (default 8)" << std::endl;
+        std::cerr << "Backend throughput and the bytes each one counted are reported on stderr." << std::endl;
+        return 1;
+    }
+
+    try {
+        processFile(filename, wanted, threads, profileBytes);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,333 @@
+#ifndef GC_WINDOWS_HPP
+#define GC_WINDOWS_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <future>
+#include <memory>
+#include <ostream>
+#include <limits>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include "fasta_reader.hpp"
+#include "fasta_stream.hpp"
+#include "thread_pool.hpp"
+
+enum class TrackFormat { BedGraph, Binary };
+
+// GC percentage in sliding windows over every record of a FASTA file.
+//
+// Windows start every `step` bases and span `window` bases; the last window
+// of a record is the first one that reaches its end and may be shorter, and
+// a record shorter than one window gets a single window. Positions count
+// sequence characters only (line breaks excluded), 0-based half-open like
+// BED. The value is 100 * GC / (bases other than N), as main_cpu reports it.
+//
+// Each record is reduced to prefix sums over bins of gcd(window, step)
+// bases, so every window is two subtractions no matter how long it is. The
+// sums are 32-bit and taken modulo 2^32: differences stay exact for windows
+// below 4 Gbp, and the bins cost 8 bytes per bin instead of 16. Records are
+// binned in parallel, windows are formatted in parallel blocks, and the
+// output is written in file order. Input that cannot be mapped (stdin,
+// gzip, BGZF) is split with FastaStreamSplitter and binned as it arrives.
+//
+// Binary tracks (host byte order): the 8-byte magic "GCTRACK1", uint32
+// window, uint32 step, then per record: uint32 name length, the name,
+// uint64 sequence length, uint64 window count and one float32 percentage
+// per window, NaN where a window holds only N.
+class GCWindowProfiler {
+private:
+    struct RecordBins {
+        std::string name;
+        uint64_t length = 0;
+        std::vector<uint32_t> gc;     // gc[b] = GC bases before bin b, mod 2^32
+        std::vector<uint32_t> bases;  // the same for bases other than N
+    };
+
+    static constexpr size_t WINDOWS_PER_BLOCK = 1 << 18;
+    static constexpr size_t MAX_BINS_IN_FLIGHT = 64 << 20;  // 512 MiB of prefix sums
+
+    ThreadPool pool;
+    uint64_t window;
+    uint64_t step;
+    uint64_t bin;
+    TrackFormat format;
+    size_t maxBlocksInFlight;
+
+    static uint64_t gcd(uint64_t a, uint64_t b) {
+        while (b != 0) {
+            uint64_t t = a % b;
+            a = b;
+            b = t;
+        }
+        return a;
+    }
+
+    // Prefix sums of one record, fed its sequence lines (without line
+    // breaks) in order, in as many pieces as they come
+    class RecordBinner {
+    private:
+        uint64_t bin;
+        RecordBins bins;
+        uint32_t gc = 0, bases = 0;
+        uint64_t left;  // bases until the current bin is full
+
+    public:
+        RecordBinner(uint64_t binSize, size_t expectedBins) : bin(binSize), left(binSize) {
+            bins.gc.reserve(expectedBins);
+            bins.bases.reserve(expectedBins);
+            bins.gc.push_back(0);
+            bins.bases.push_back(0);
+        }
+
+        void addLine(std::string_view line) {
+            static const struct Tables {
+                uint8_t gc[256];
+                uint8_t base[256];
+                Tables() {
+                    for (int c = 0; c < 256; ++c) {
+                        char lower = static_cast<char>(c | 0x20);
+                        gc[c] = (lower == 'g') | (lower == 'c');
+                        base[c] = lower != 'n';
+                    }
+                }
+            } tables;
+
+            bins.length += line.size();
+            for (unsigned char c : line) {
+                gc += tables.gc[c];
+                bases += tables.base[c];
+                if (--left == 0) {
+                    bins.gc.push_back(gc);
+                    bins.bases.push_back(bases);
+                    left = bin;
+                }
+            }
+        }
+
+        uint64_t length() const { return bins.length; }
+
+        RecordBins finish(std::string_view name) {
+            if (left != bin) {  // partial last bin
+                bins.gc.push_back(gc);
+                bins.bases.push_back(bases);
+            }
+            bins.name = std::string(name);
+            return std::move(bins);
+        }
+    };
+
+    RecordBins binRecord(const FastaRecord& record) const {
+        RecordBinner binner(bin, record.body.size() / bin + 2);
+        record.forEachLine([&](std::string_view line) { binner.addLine(line); });
+        return binner.finish(record.name());
+    }
+
+    uint64_t windowCount(uint64_t length) const {
+        if (length <= window) return 1;
+        // Up to the first window reaching the end, or with step > window
+        // the last one starting inside the record
+        return std::min(1 + (length - window + step - 1) / step, (length + step - 1) / step);
+    }
+
+    // Percentage of window k, or a negative value when it holds only N
+    double windowValue(const RecordBins& bins, uint64_t k, uint64_t& start, uint64_t& end) const {
+        start = k * step;
+        end = std::min(start + window, bins.length);
+        size_t first = start / bin;
+        size_t last = (end + bin - 1) / bin;
+        uint32_t gc = bins.gc[last] - bins.gc[first];
+        uint32_t bases = bins.bases[last] - bins.bases[first];
+        return bases == 0 ? -1.0 : 100.0 * gc / bases;
+    }
+
+    // bedGraph lines of windows [first, last); all-N windows are left out
+    std::string formatBedGraph(const RecordBins& bins, uint64_t first, uint64_t last) const {
+        std::string text;
+        text.reserve((last - first) * (bins.name.size() + 32));
+        char number[24];
+        auto appendNumber = [&](uint64_t value) {
+            text.append(number, std::to_chars(number, number + sizeof(number), value).ptr);
+        };
+        for (uint64_t k = first; k < last; ++k) {
+            uint64_t start, end;
+            double value = windowValue(bins, k, start, end);
+            if (value < 0) continue;
+            uint64_t hundredths = static_cast<uint64_t>(value * 100.0 + 0.5);  // two decimals
+            text += bins.name;
+            text += '\t';
+            appendNumber(start);
+            text += '\t';
+            appendNumber(end);
+            text += '\t';
+            appendNumber(hundredths / 100);
+            text += '.';
+            text += static_cast<char>('0' + hundredths / 10 % 10);
+            text += static_cast<char>('0' + hundredths % 10);
+            text += '\n';
+        }
+        return text;
+    }
+
+    std::string formatBinary(const RecordBins& bins, uint64_t first, uint64_t last) const {
+        std::string data((last - first) * sizeof(float), '\0');
+        char* p = &data[0];
+        for (uint64_t k = first; k < last; ++k) {
+            uint64_t start, end;
+            double value = windowValue(bins, k, start, end);
+            float percentage = value < 0 ? std::numeric_limits<float>::quiet_NaN() : static_cast<float>(value);
+            std::memcpy(p, &percentage, sizeof(float));
+            p += sizeof(float);
+        }
+        return data;
+    }
+
+    template <typename T>
+    static void appendRaw(std::string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    // Write the track of the records produce(queue) passes, in order, to
+    // queue(bins, estimated bin count): formatting runs on the pool while
+    // more records are binned, within a bound on prefix-sum memory
+    template <typename Produce>
+    void writeTrack(std::ostream& out, Produce&& produce) {
+        std::deque<std::future<RecordBins>> binning;
+        std::deque<std::future<std::string>> blocks;
+        size_t binsInFlight = 0;
+        std::deque<size_t> binEstimates;
+
+        if (format == TrackFormat::Binary) {
+            std::string header("GCTRACK1");
+            appendRaw(header, static_cast<uint32_t>(window));
+            appendRaw(header, static_cast<uint32_t>(step));
+            out.write(header.data(), header.size());
+        }
+
+        auto writeFront = [&]() {
+            std::string text = blocks.front().get();
+            blocks.pop_front();
+            out.write(text.data(), text.size());
+        };
+
+        // Cut the oldest binned record into window blocks; its bins stay
+        // alive until the last of its blocks is formatted
+        auto formatFront = [&]() {
+            auto bins = std::make_shared<RecordBins>(binning.front().get());
+            binning.pop_front();
+            binsInFlight -= binEstimates.front();
+            binEstimates.pop_front();
+
+            uint64_t count = windowCount(bins->length);
+            if (format == TrackFormat::Binary) {
+                std::string header;
+                appendRaw(header, static_cast<uint32_t>(bins->name.size()));
+                header += bins->name;
+                appendRaw(header, bins->length);
+                appendRaw(header, count);
+                blocks.push_back(readyFuture(std::move(header)));
+            }
+            for (uint64_t first = 0; first < count; first += WINDOWS_PER_BLOCK) {
+                uint64_t last = std::min<uint64_t>(count, first + WINDOWS_PER_BLOCK);
+                blocks.push_back(pool.submit([this, bins, first, last] {
+                    return format == TrackFormat::Binary ? formatBinary(*bins, first, last)
+                                                         : formatBedGraph(*bins, first, last);
+                }));
+                while (blocks.size() > maxBlocksInFlight) writeFront();
+            }
+        };
+
+        auto queue = [&](std::future<RecordBins> bins, size_t estimate) {
+            binning.push_back(std::move(bins));
+            binEstimates.push_back(estimate);
+            binsInFlight += estimate;
+            while ((binsInFlight > MAX_BINS_IN_FLIGHT || binning.size() > pool.size()) && binning.size() > 1) {
+                formatFront();
+            }
+        };
+        produce(queue);
+
+        while (!binning.empty()) formatFront();
+        while (!blocks.empty()) writeFront();
+        out.flush();
+    }
+
+    template <typename T>
+    static std::future<T> readyFuture(T value) {
+        std::promise<T> ready;
+        ready.set_value(std::move(value));
+        return ready.get_future();
+    }
+
+public:
+    // threads == 0 uses every hardware thread
+    GCWindowProfiler(uint64_t windowSize, uint64_t stepSize, TrackFormat trackFormat, size_t threads = 0)
+        : pool(threads), window(windowSize), step(stepSize), format(trackFormat),
+          maxBlocksInFlight(pool.size() * 2) {
+        if (window == 0 || step == 0) {
+            throw std::invalid_argument("Window and step must be positive");
+        }
+        if (window > std::numeric_limits<uint32_t>::max() || step > std::numeric_limits<uint32_t>::max()) {
+            throw std::invalid_argument("Window and step must be below 4 Gbp");
+        }
+        bin = gcd(window, step);
+    }
+
+    size_t threadCount() const { return pool.size(); }
+
+    // Write the track of every non-empty record of reader to out. stop() is
+    // polled between records; returning true ends the run early.
+    template <typename Stop>
+    void run(FastaReader& reader, std::ostream& out, Stop&& stop) {
+        writeTrack(out, [&](auto& queue) {
+            FastaRecord record;
+            while (!stop() && reader.next(record)) {
+                // Records without any sequence data are not numbered
+                if (record.empty()) continue;
+                queue(pool.submit([this, record] { return binRecord(record); }), record.body.size() / bin + 2);
+            }
+        });
+    }
+
+    void run(FastaReader& reader, std::ostream& out) {
+        run(reader, out, [] { return false; });
+    }
+
+    // The same over a FASTA byte stream (stdin, gzip, BGZF): records are
+    // binned on the calling thread as the input arrives, so the track is
+    // ready one pass over the input later. stop() is polled between pieces
+    // of input.
+    template <typename Stop>
+    void run(ByteStream& in, std::ostream& out, Stop&& stop) {
+        writeTrack(out, [&](auto& queue) {
+            RecordBinner binner(bin, 0);
+            FastaStreamSplitter().run(in,
+                [&](std::string_view bytes) {
+                    // Sequence lines without "\n" and "\r"
+                    const char* p = bytes.data();
+                    const char* end = p + bytes.size();
+                    while (p < end) {
+                        const char* q = p;
+                        while (q < end && *q != '\n' && *q != '\r') ++q;
+                        if (q > p) binner.addLine(std::string_view(p, q - p));
+                        p = q < end ? q + 1 : end;
+                    }
+                },
+                [&](std::string_view name) {
+                    if (binner.length() != 0) {  // no sequence data otherwise
+                        RecordBins bins = binner.finish(name);
+                        size_t count = bins.gc.size();
+                        queue(readyFuture(std::move(bins)), count);
+                    }
+                    binner = RecordBinner(bin, 0);
+                },
+                stop);
+        });
+    }
+};
+
+#endif
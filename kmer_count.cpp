@@ -0,0 +1,167 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <csignal>
+#include <atomic>
+#include <cstdlib>
+#include <stdexcept>
+#include "fasta_reader.hpp"
+#include "kmer_counter.hpp"
+
+// Canonical k-mer counts over every record of a FASTA file: a histogram of
+// the counts (the k-mer spectrum), and optionally the counts themselves as
+// a binary dump or text
+
+std::atomic<bool> interrupted(false); // Flag for interruption
+
+void signalHandler(int) {
+    interrupted = true;
+}
+
+// Distinct k-mers per count; counts are mostly small, so those sit in a
+// vector and the rare large ones in a map
+class CountHistogram {
+private:
+    static constexpr uint32_t DENSE_COUNTS = 1 << 16;
+
+    std::vector<uint64_t> dense = std::vector<uint64_t>(DENSE_COUNTS, 0);
+    std::map<uint32_t, uint64_t> sparse;
+
+public:
+    void add(uint32_t count) {
+        if (count < DENSE_COUNTS) {
+            ++dense[count];
+        } else {
+            ++sparse[count];
+        }
+    }
+
+    // "count<TAB>distinct k-mers" for every count that occurs, ascending
+    void write(std::ostream& out) const {
+        for (uint32_t count = 1; count < DENSE_COUNTS; ++count) {
+            if (dense[count] != 0) out << count << '\t' << dense[count] << '\n';
+        }
+        for (const auto& entry : sparse) out << entry.first << '\t' << entry.second << '\n';
+    }
+};
+
+std::ofstream openOutput(const std::string& filename, std::ios::openmode mode = std::ios::out) {
+    std::ofstream out(filename, mode);
+    if (!out) {
+        throw std::runtime_error("Cannot open output file: " + filename);
+    }
+    return out;
+}
+
+int main(int argc, char* argv[]) {
+    std::string filename, histogramFile, dumpFile, textFile;
+    std::string tempDir = ".";
+    size_t k = 21;
+    size_t threads = 0;
+    size_t memoryMiB = 1024;
+    size_t partitions = 64;
+    bool usage = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-k" && i + 1 < argc) {
+            k = std::strtoul(argv[++i], nullptr, 10);
+            usage |= k < 1 || k > KMER_MAX_LENGTH;
+        } else if ((arg == "-t" || arg == "--threads") && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);  // 0 = all cores
+        } else if ((arg == "-m" || arg == "--memory") && i + 1 < argc) {
+            memoryMiB = std::strtoul(argv[++i], nullptr, 10);
+            usage |= memoryMiB == 0;
+        } else if (arg == "--partitions" && i + 1 < argc) {
+            partitions = std::strtoul(argv[++i], nullptr, 10);
+            usage |= partitions == 0;
+        } else if (arg == "--tmp" && i + 1 < argc) {
+            tempDir = argv[++i];
+        } else if ((arg == "-o" || arg == "--histo") && i + 1 < argc) {
+            histogramFile = argv[++i];
+        } else if (arg == "--dump" && i + 1 < argc) {
+            dumpFile = argv[++i];
+        } else if (arg == "--text" && i + 1 < argc) {
+            textFile = argv[++i];
+        } else if (filename.empty()) {
+            filename = arg;
+        } else {
+            usage = true;
+        }
+    }
+
+    if (usage || filename.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [-k <k>] [-t <threads>] [-m <MiB>] [--partitions <n>] [--tmp <dir>]"
+                  << " [-o <histogram>] [--dump <file>] [--text <file>] <FASTA file>" << std::endl;
+        std::cerr << "  -k N              k-mer length, 1 to " << KMER_MAX_LENGTH << " (default 21); a k-mer and its"
+                  << std::endl;
+        std::cerr << "                    reverse complement count as one, k-mers with N are skipped" << std::endl;
+        std::cerr << "  -t, --threads N   count on N threads (0 = all cores, the default)" << std::endl;
+        std::cerr << "  -m, --memory N    size the count table to N MiB (default 1024); when it fills" << std::endl;
+        std::cerr << "                    the counts are spilled to disk and merged at the end" << std::endl;
+        std::cerr << "  --partitions N    split spilled counts into N files (default 64); each one is" << std::endl;
+        std::cerr << "                    merged on its own and must fit in the table" << std::endl;
+        std::cerr << "  --tmp DIR         directory of the spill files (default .)" << std::endl;
+        std::cerr << "  -o, --histo FILE  write the histogram (count, distinct k-mers) to FILE, not stdout"
+                  << std::endl;
+        std::cerr << "  --dump FILE       write every k-mer and its count to FILE in binary (see" << std::endl;
+        std::cerr << "                    kmer_counter.hpp)" << std::endl;
+        std::cerr << "  --text FILE       write every k-mer and its count to FILE as text" << std::endl;
+        return 1;
+    }
+
+    signal(SIGINT, signalHandler);
+
+    try {
+        FastaReader reader(filename);
+        KmerCounter counter(k, threads, memoryMiB << 20, partitions, tempDir);
+        counter.run(reader, [] { return interrupted.load(); });
+        if (interrupted.load()) {
+            std::cerr << "\nInterrupt received. Exiting..." << std::endl;
+            return 1;
+        }
+
+        std::ofstream dump, text;
+        std::unique_ptr<KmerDumpWriter> dumpWriter;
+        if (!dumpFile.empty()) {
+            dump = openOutput(dumpFile, std::ios::binary);
+            dumpWriter.reset(new KmerDumpWriter(dump, k));
+        }
+        if (!textFile.empty()) text = openOutput(textFile);
+
+        CountHistogram histogram;
+        uint64_t total = 0, distinct = 0;
+        counter.forEachCount([&](uint64_t key, uint32_t count) {
+            histogram.add(count);
+            total += count;
+            ++distinct;
+            if (dumpWriter) dumpWriter->add(key, count);
+            if (text.is_open()) text << decodeKmer(key, k) << '\t' << count << '\n';
+        });
+        if (dumpWriter) {
+            dumpWriter->flush();
+            if (!dump) throw std::runtime_error("Cannot write " + dumpFile);
+        }
+        if (text.is_open() && !text) throw std::runtime_error("Cannot write " + textFile);
+
+        if (histogramFile.empty()) {
+            histogram.write(std::cout);
+        } else {
+            std::ofstream out = openOutput(histogramFile);
+            histogram.write(out);
+            if (!out) throw std::runtime_error("Cannot write " + histogramFile);
+        }
+
+        std::cerr << total << " " << k << "-mers, " << distinct << " distinct, on " << counter.threadCount()
+                  << " threads with a " << counter.tableBytes() / double(1 << 20) << " MiB table, "
+                  << counter.spillCount() << " spills" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,409 @@
+#ifndef KMER_COUNTER_HPP
+#define KMER_COUNTER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <fstream>
+#include <ostream>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#include "fasta_reader.hpp"
+#include "dna_sequence.hpp"
+#include "thread_pool.hpp"
+
+// Canonical k-mer counting (k <= 31, 2 bits per base in a 64-bit key) over
+// every record of a FASTA file. A k-mer and its reverse complement count as
+// one, keyed by the smaller code; k-mers holding N or other non-ACGT
+// characters are skipped, soft-masked bases count like upper case ones.
+//
+// Record bodies are cut into chunks counted on a thread pool, as in
+// ParallelGCCounter. Workers share one open-addressing table: keys are
+// claimed with a compare-and-swap on an empty slot, counts are atomic
+// increments, so no locks are taken. The table is sized from the memory
+// budget and is "full" at 3/4 load. When it fills, the chunks in flight
+// finish (k-mers they could not add are kept aside), the table is spilled
+// to disk as (key, count) runs split into partitions by key hash, and
+// counting resumes in the emptied table. At the end each partition is
+// loaded back on its own and its runs summed, so memory stays bounded by
+// the budget as long as one partition's distinct k-mers fit in the table.
+
+const size_t KMER_MAX_LENGTH = 31;
+
+// Lock-free open-addressing table of k-mer counts with linear probing
+class ConcurrentKmerTable {
+private:
+    static constexpr uint64_t EMPTY = ~uint64_t(0);  // never a k-mer: codes use at most 62 bits
+
+    std::unique_ptr<std::atomic<uint64_t>[]> keys;
+    std::unique_ptr<std::atomic<uint32_t>[]> counts;
+    size_t capacity = 0;
+    size_t limit = 0;  // distinct keys at which the table counts as full
+    std::atomic<size_t> used{0};
+
+public:
+    static constexpr size_t SLOT_BYTES = sizeof(uint64_t) + sizeof(uint32_t);
+
+    // Largest power-of-two table within bytes (at least 1024 slots)
+    explicit ConcurrentKmerTable(size_t bytes) {
+        capacity = 1024;
+        while (capacity * 2 * SLOT_BYTES <= bytes) capacity *= 2;
+        limit = capacity / 4 * 3;
+        keys.reset(new std::atomic<uint64_t>[capacity]);
+        counts.reset(new std::atomic<uint32_t>[capacity]);
+        clear();
+    }
+
+    // 64-bit finalizer (MurmurHash3's fmix64): low bits pick the slot, high
+    // bits the spill partition
+    static uint64_t mix(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return key;
+    }
+
+    // Add count to key; false when key is new and the table is full
+    bool add(uint64_t key, uint32_t count = 1) {
+        size_t mask = capacity - 1;
+        for (size_t slot = mix(key) & mask;; slot = (slot + 1) & mask) {
+            uint64_t current = keys[slot].load(std::memory_order_relaxed);
+            if (current == EMPTY) {
+                if (used.load(std::memory_order_relaxed) >= limit) return false;
+                if (keys[slot].compare_exchange_strong(current, key, std::memory_order_relaxed)) {
+                    used.fetch_add(1, std::memory_order_relaxed);
+                    current = key;
+                }
+                // else another worker claimed the slot, maybe for this key
+            }
+            if (current == key) {
+                counts[slot].fetch_add(count, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+
+    // Only call while no worker is adding
+    void clear() {
+        for (size_t slot = 0; slot < capacity; ++slot) {
+            keys[slot].store(EMPTY, std::memory_order_relaxed);
+            counts[slot].store(0, std::memory_order_relaxed);
+        }
+        used.store(0);
+    }
+
+    bool full() const { return used.load(std::memory_order_relaxed) >= limit; }
+    size_t size() const { return used.load(); }
+    size_t slots() const { return capacity; }
+    size_t memoryUsage() const { return capacity * SLOT_BYTES; }
+
+    // emit(key, count) for every key; only call while no worker is adding
+    template <typename Emit>
+    void forEach(Emit&& emit) const {
+        for (size_t slot = 0; slot < capacity; ++slot) {
+            uint64_t key = keys[slot].load(std::memory_order_relaxed);
+            if (key != EMPTY) emit(key, counts[slot].load(std::memory_order_relaxed));
+        }
+    }
+};
+
+class KmerCounter {
+private:
+    static constexpr size_t SPILL_RECORD_BYTES = 12;        // uint64 key, uint32 count
+    static constexpr size_t SPILL_BUFFER_BYTES = 1 << 18;   // per partition while spilling
+
+    ThreadPool pool;
+    size_t k;
+    size_t chunkSize;
+    size_t maxChunksInFlight;
+    ConcurrentKmerTable table;
+    size_t partitions;
+    std::string spillPrefix;
+    std::vector<std::string> spillFiles;  // one per partition once spilled
+    size_t spills = 0;
+
+    // Byte classes of the scanner: 0-3 a base, SKIP a line break, RESET
+    // anything else (breaks the k-mer)
+    static constexpr uint8_t SKIP = 4, RESET = 5;
+
+    static const uint8_t* byteClasses() {
+        static const struct Table {
+            uint8_t value[256];
+            Table() {
+                for (int c = 0; c < 256; ++c) {
+                    int code = dnaCode(static_cast<char>(c));
+                    value[c] = code >= 0 ? static_cast<uint8_t>(code) : RESET;
+                }
+                value[static_cast<unsigned char>('\n')] = SKIP;
+                value[static_cast<unsigned char>('\r')] = SKIP;
+            }
+        } table;
+        return table.value;
+    }
+
+    // Count the canonical k-mers whose last base lies in body[offset, end).
+    // Scanning starts up to k - 1 bases earlier so k-mers crossing the
+    // chunk start are seen whole. Returns the k-mers the full table refused.
+    std::vector<uint64_t> countChunk(std::string_view body, size_t offset, size_t end) {
+        const uint8_t* classes = byteClasses();
+        size_t begin = offset;
+        for (size_t need = k - 1; need > 0 && begin > 0;) {
+            uint8_t c = classes[static_cast<unsigned char>(body[begin - 1])];
+            if (c == RESET) break;
+            if (c != SKIP) --need;
+            --begin;
+        }
+
+        const uint64_t mask = (uint64_t(1) << (2 * k)) - 1;
+        const unsigned shift = static_cast<unsigned>(2 * (k - 1));
+        uint64_t forward = 0, reverse = 0;
+        size_t valid = 0;
+        std::vector<uint64_t> refused;
+        for (size_t i = begin; i < end; ++i) {
+            uint8_t c = classes[static_cast<unsigned char>(body[i])];
+            if (c == SKIP) continue;
+            if (c == RESET) {
+                valid = 0;
+                continue;
+            }
+            forward = ((forward << 2) | c) & mask;
+            reverse = (reverse >> 2) | (uint64_t(3 - c) << shift);
+            if (++valid < k || i < offset) continue;
+            uint64_t key = std::min(forward, reverse);
+            if (!table.add(key)) refused.push_back(key);
+        }
+        return refused;
+    }
+
+    // Append the table to the partition files and empty it
+    void spill() {
+        if (spillFiles.empty()) {
+            for (size_t p = 0; p < partitions; ++p) {
+                spillFiles.push_back(spillPrefix + std::to_string(p) + ".bin");
+                std::ofstream create(spillFiles.back(), std::ios::binary | std::ios::trunc);
+                if (!create) throw std::runtime_error("Cannot create spill file: " + spillFiles.back());
+            }
+        }
+        std::vector<std::ofstream> files;
+        std::vector<std::string> buffers(partitions);
+        for (const std::string& name : spillFiles) {
+            files.emplace_back(name, std::ios::binary | std::ios::app);
+        }
+        auto flushPartition = [&](size_t p) {
+            files[p].write(buffers[p].data(), static_cast<std::streamsize>(buffers[p].size()));
+            buffers[p].clear();
+        };
+        table.forEach([&](uint64_t key, uint32_t count) {
+            size_t p = partitionOf(key);
+            char record[SPILL_RECORD_BYTES];
+            std::memcpy(record, &key, sizeof(key));
+            std::memcpy(record + sizeof(key), &count, sizeof(count));
+            buffers[p].append(record, SPILL_RECORD_BYTES);
+            if (buffers[p].size() >= SPILL_BUFFER_BYTES) flushPartition(p);
+        });
+        for (size_t p = 0; p < partitions; ++p) {
+            flushPartition(p);
+            if (!files[p]) throw std::runtime_error("Cannot write spill file: " + spillFiles[p]);
+        }
+        table.clear();
+        ++spills;
+    }
+
+    size_t partitionOf(uint64_t key) const {
+        return static_cast<size_t>((ConcurrentKmerTable::mix(key) >> 32) % partitions);
+    }
+
+    // Spill the full table, then add the k-mers it refused, spilling again
+    // whenever it fills
+    void spillAndAbsorb(std::vector<uint64_t>& refused) {
+        do {
+            spill();
+            std::vector<uint64_t> again;
+            for (uint64_t key : refused) {
+                if (!table.add(key)) again.push_back(key);
+            }
+            refused.swap(again);
+        } while (!refused.empty());
+    }
+
+    // Load one partition's runs into the empty table, summing counts
+    void loadPartition(size_t p) {
+        std::ifstream in(spillFiles[p], std::ios::binary);
+        if (!in) throw std::runtime_error("Cannot read spill file: " + spillFiles[p]);
+        std::vector<char> block(SPILL_BUFFER_BYTES / SPILL_RECORD_BYTES * SPILL_RECORD_BYTES);
+        while (in) {
+            in.read(block.data(), static_cast<std::streamsize>(block.size()));
+            size_t records = static_cast<size_t>(in.gcount()) / SPILL_RECORD_BYTES;
+            for (size_t r = 0; r < records; ++r) {
+                uint64_t key;
+                uint32_t count;
+                std::memcpy(&key, &block[r * SPILL_RECORD_BYTES], sizeof(key));
+                std::memcpy(&count, &block[r * SPILL_RECORD_BYTES + sizeof(key)], sizeof(count));
+                if (!table.add(key, count)) {
+                    throw std::runtime_error("A spill partition does not fit in memory; raise the memory budget"
+                                             " or the number of partitions");
+                }
+            }
+        }
+    }
+
+    void removeSpillFiles() {
+        for (const std::string& name : spillFiles) std::remove(name.c_str());
+        spillFiles.clear();
+    }
+
+public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 1 << 20;  // 1 MiB of raw record body
+
+    // threads == 0 uses every hardware thread; spill files are created as
+    // tempDir/kmers.<pid>.<partition>.bin
+    KmerCounter(size_t kmerLength, size_t threads, size_t memoryBytes, size_t partitionCount,
+                const std::string& tempDir = ".")
+        : pool(threads), k(kmerLength), chunkSize(DEFAULT_CHUNK_SIZE), maxChunksInFlight(pool.size() * 2),
+          table(memoryBytes), partitions(std::max<size_t>(1, partitionCount)),
+          spillPrefix(tempDir + "/kmers." + std::to_string(getpid()) + ".") {
+        if (k < 1 || k > KMER_MAX_LENGTH) {
+            throw std::invalid_argument("k must be between 1 and " + std::to_string(KMER_MAX_LENGTH));
+        }
+    }
+
+    ~KmerCounter() { removeSpillFiles(); }
+
+    KmerCounter(const KmerCounter&) = delete;
+    KmerCounter& operator=(const KmerCounter&) = delete;
+
+    size_t threadCount() const { return pool.size(); }
+    size_t kmerLength() const { return k; }
+    size_t spillCount() const { return spills; }
+    size_t tableBytes() const { return table.memoryUsage(); }
+
+    // Count every non-empty record of reader. stop() is polled between
+    // records; returning true ends the run early.
+    template <typename Stop>
+    void run(FastaReader& reader, Stop&& stop) {
+        std::deque<std::future<std::vector<uint64_t> > > running;
+        std::vector<uint64_t> refused;
+
+        auto finishFront = [&]() {
+            std::vector<uint64_t> part = running.front().get();
+            running.pop_front();
+            refused.insert(refused.end(), part.begin(), part.end());
+        };
+        // Wait for every chunk even after a failure: they use the table
+        auto drain = [&]() {
+            std::exception_ptr error;
+            while (!running.empty()) {
+                try {
+                    finishFront();
+                } catch (...) {
+                    if (!error) error = std::current_exception();
+                }
+            }
+            if (error) std::rethrow_exception(error);
+        };
+
+        try {
+            FastaRecord record;
+            while (!stop() && reader.next(record)) {
+                if (record.empty()) continue;
+                std::string_view body = record.body;
+                for (size_t offset = 0; offset < body.size(); offset += chunkSize) {
+                    if (table.full()) {
+                        drain();
+                        spillAndAbsorb(refused);
+                    }
+                    size_t end = std::min(body.size(), offset + chunkSize);
+                    running.push_back(pool.submit([this, body, offset, end] {
+                        return countChunk(body, offset, end);
+                    }));
+                    while (running.size() > maxChunksInFlight) finishFront();
+                }
+            }
+            drain();
+            if (!refused.empty()) spillAndAbsorb(refused);
+        } catch (...) {
+            std::exception_ptr error = std::current_exception();
+            try {
+                drain();
+            } catch (...) {
+            }
+            std::rethrow_exception(error);
+        }
+    }
+
+    void run(FastaReader& reader) {
+        run(reader, [] { return false; });
+    }
+
+    // emit(key, count) for every distinct canonical k-mer. After a spill
+    // this goes one partition after another, so keys come in no particular
+    // order. Call once, after run().
+    template <typename Emit>
+    void forEachCount(Emit&& emit) {
+        if (spills == 0) {
+            table.forEach(emit);
+            return;
+        }
+        spill();
+        for (size_t p = 0; p < partitions; ++p) {
+            loadPartition(p);
+            std::remove(spillFiles[p].c_str());
+            table.forEach(emit);
+            table.clear();
+        }
+        spillFiles.clear();
+    }
+};
+
+// Binary dumps (host byte order): the 8-byte magic "KMERCNT1", uint32 k,
+// uint32 key bytes ((2k + 7) / 8), then per k-mer its key's low key-bytes
+// bytes, least significant first, and a uint32 count, to the end of the file
+class KmerDumpWriter {
+private:
+    static constexpr size_t BUFFER_BYTES = 1 << 20;
+
+    std::ostream& out;
+    size_t keyBytes;
+    std::string buffer;
+
+public:
+    KmerDumpWriter(std::ostream& output, size_t k) : out(output), keyBytes((2 * k + 7) / 8) {
+        uint32_t header[2] = {static_cast<uint32_t>(k), static_cast<uint32_t>(keyBytes)};
+        out.write("KMERCNT1", 8);
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        buffer.reserve(BUFFER_BYTES + keyBytes + sizeof(uint32_t));
+    }
+
+    void add(uint64_t key, uint32_t count) {
+        for (size_t b = 0; b < keyBytes; ++b) buffer += static_cast<char>((key >> (8 * b)) & 0xff);
+        buffer.append(reinterpret_cast<const char*>(&count), sizeof(count));
+        if (buffer.size() >= BUFFER_BYTES) flush();
+    }
+
+    void flush() {
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+};
+
+// Text form of a k-mer code
+inline std::string decodeKmer(uint64_t key, size_t k) {
+    std::string text(k, 'A');
+    for (size_t i = 0; i < k; ++i) {
+        text[k - 1 - i] = "ACGT"[(key >> (2 * i)) & 3];
+    }
+    return text;
+}
+
+#endif
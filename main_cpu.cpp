@@ -1,9 +1,16 @@
 #include <iostream>
-#include <fstream>
 #include <string>
+#include <vector>
 #include <csignal>
 #include <atomic>
-#include <regex>
+#include <cstdlib>
+#include <fstream>
+#include "fasta_reader.hpp"
+#include "gc_counter.hpp"
+#include "gc_pipeline.hpp"
+#include "fasta_stream.hpp"
+#include "gc_windows.hpp"
+#include "fasta_index.hpp"
 
 std::atomic<bool> interrupted(false); // Flag for interruption
 
@@ -14,20 +21,10 @@ void signalHandler(int signum) {
     exit(signum);
 }
 
-// Function to process each sequence and calculate GC content
-void processSequence(const std::string& sequence, const std::string& header, int sequenceNumber) {
-    int gcCount = 0;
-    int totalBases = 0;
-
-    // Calculate GC count and total base count for this sequence
-    for (char base : sequence) {
-        if (base == 'G' || base == 'C') {
-            gcCount++;
-        }
-        if (base != 'N') { // Count bases other than 'N'
-            totalBases++;
-        }
-    }
+// Print the GC report for one record
+void printSequenceGC(std::string_view name, int sequenceNumber, const GCCounts& counts) {
+    uint64_t gcCount = counts.gc;
+    uint64_t totalBases = counts.bases();  // Bases other than 'N'
 
     // Ensure we don't divide by zero
     if (totalBases == 0) {
@@ -39,38 +36,30 @@ void processSequence(const std::string& sequence, const std::string& header, int
     float gcPercentage = (static_cast<float>(gcCount) / totalBases) * 100.0f;
 
     // Print sequence header, number, GC count, and percentage
-    std::cout << "Sequence " << sequenceNumber << " (" << header << "):" << std::endl;
+    std::cout << "Sequence " << sequenceNumber << " (" << name << "):" << std::endl;
     std::cout << "GC count: " << gcCount << std::endl;
     std::cout << "Percentage: " << gcPercentage << "%" << std::endl;
 }
 
+// Function to process each sequence and calculate GC content
+void processSequence(const FastaRecord& record, int sequenceNumber) {
+    // Count the raw record body in one pass; the SIMD kernel skips line breaks
+    // and counts soft-masked (lower case) bases like upper case ones
+    GCCounts counts = countGC(record.body.data(), record.body.size());
+    printSequenceGC(record.name(), sequenceNumber, counts);
+}
+
 // Function to process the file and count GC for each sequence
 void processFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Could not open file: " << filename << std::endl;
-        return;
-    }
-
-    std::string line;
-    std::string sequence;
+    FastaReader reader(filename);
+    FastaRecord record;
     int sequenceNumber = 0;  // Sequence counter
-    std::string header;
-
-    // Process each line in the file
-    while (std::getline(file, line)) {
-        // Check for header line (starts with '>')
-        if (line[0] == '>') {
-            // If there was a previous sequence, process it
-            if (!sequence.empty()) {
-                processSequence(sequence, header, sequenceNumber++);
-                sequence.clear(); // Clear sequence for next one
-            }
-            // Extract the header (sequence name)
-            header = line.substr(1, line.find(' ') - 1);  // Get the part before the first space
-        } else {
-            // Append the sequence data (ignore newline characters)
-            sequence += line;
+
+    // Walk the memory-mapped records; sequence lines are never copied
+    while (reader.next(record)) {
+        // Records without any sequence data are not numbered
+        if (!record.empty()) {
+            processSequence(record, sequenceNumber++);
         }
 
         // Handle interruption gracefully
@@ -79,18 +68,164 @@ void processFile(const std::string& filename) {
             break;
         }
     }
+}
+
+// Parallel variant of processFile: records are split into chunks that are
+// counted on a thread pool, and reported in file order with the same output
+void processFileParallel(const std::string& filename, size_t threads) {
+    FastaReader reader(filename);
+    ParallelGCCounter counter(threads);
+    int sequenceNumber = 0;  // Sequence counter
+
+    counter.run(reader,
+        [&](const FastaRecord& record, const GCCounts& counts) {
+            printSequenceGC(record.name(), sequenceNumber++, counts);
+        },
+        [] {
+            // Handle interruption gracefully
+            if (interrupted.load()) {
+                std::cout << "\nInterrupt received. Exiting..." << std::endl;
+                return true;
+            }
+            return false;
+        });
+}
+
+// GC of named records or parts of them ("chr:start-end"), read through the
+// file's .fai index without scanning the rest of the file
+void processRegions(const std::string& filename, const std::vector<std::string>& regions, size_t threads) {
+    IndexedFasta fasta(filename, threads);
+    int sequenceNumber = 0;  // Sequence counter
 
-    // Process the last sequence in the file (if any)
-    if (!sequence.empty()) {
-        processSequence(sequence, header, sequenceNumber);
+    for (const std::string& text : regions) {
+        std::string_view bytes = fasta.raw(fasta.region(text));
+        printSequenceGC(text, sequenceNumber++, countGC(bytes.data(), bytes.size()));
     }
+}
 
-    file.close();
+// Streaming variant for stdin, pipes and gzip/BGZF files: counts are updated
+// as the input arrives, in fixed memory however long a record is; threads
+// decompress BGZF blocks
+void processStream(const std::string& filename, size_t threads) {
+    std::unique_ptr<ByteStream> input = openByteStream(filename, threads);
+    StreamingGCCounter counter;
+    int sequenceNumber = 0;  // Sequence counter
+
+    counter.run(*input,
+        [&](std::string_view name, const GCCounts& counts) {
+            printSequenceGC(name, sequenceNumber++, counts);
+        },
+        [] {
+            // Handle interruption gracefully
+            if (interrupted.load()) {
+                std::cout << "\nInterrupt received. Exiting..." << std::endl;
+                return true;
+            }
+            return false;
+        });
+}
+
+// GC in sliding windows over every record, as bedGraph or a binary track;
+// stdin and gzip/BGZF input are binned as they are read
+void processFileWindows(const std::string& filename, bool stream, size_t threads, uint64_t window, uint64_t step,
+                        TrackFormat format, const std::string& outputFile) {
+    GCWindowProfiler profiler(window, step, format, threads);
+
+    std::ofstream file;
+    if (!outputFile.empty()) {
+        file.open(outputFile, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Cannot open output file: " + outputFile);
+        }
+    }
+    std::ostream& out = outputFile.empty() ? std::cout : file;
+
+    auto stop = [] {
+        // Handle interruption gracefully
+        if (interrupted.load()) {
+            std::cerr << "\nInterrupt received. Exiting..." << std::endl;
+            return true;
+        }
+        return false;
+    };
+    if (stream) {
+        std::unique_ptr<ByteStream> input = openByteStream(filename, threads);
+        profiler.run(*input, out, stop);
+    } else {
+        FastaReader reader(filename);
+        profiler.run(reader, out, stop);
+    }
+    if (!out) {
+        throw std::runtime_error("Cannot write track output");
+    }
 }
 
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <FASTA file>" << std::endl;
+    std::string filename;
+    bool parallel = false;
+    bool stream = false;
+    uint64_t window = 0;
+    uint64_t step = 0;
+    TrackFormat format = TrackFormat::BedGraph;
+    std::string outputFile;
+    std::vector<std::string> regions;
+    bool windowOptions = false;  // -w, -s, --format or -o given
+    bool usage = false;
+    size_t threads = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-t" || arg == "--threads") && i + 1 < argc) {
+            parallel = true;
+            threads = std::strtoul(argv[++i], nullptr, 10);  // 0 = all cores
+        } else if (arg == "--stream") {
+            stream = true;
+        } else if ((arg == "-w" || arg == "--window") && i + 1 < argc) {
+            window = std::strtoull(argv[++i], nullptr, 10);
+            usage |= window == 0;
+            windowOptions = true;
+        } else if ((arg == "-s" || arg == "--step") && i + 1 < argc) {
+            step = std::strtoull(argv[++i], nullptr, 10);
+            usage |= step == 0;
+            windowOptions = true;
+        } else if (arg == "--format" && i + 1 < argc) {
+            std::string name = argv[++i];
+            windowOptions = true;
+            if (name == "bedgraph") {
+                format = TrackFormat::BedGraph;
+            } else if (name == "binary") {
+                format = TrackFormat::Binary;
+            } else {
+                usage = true;
+            }
+        } else if ((arg == "-o" || arg == "--output") && i + 1 < argc) {
+            outputFile = argv[++i];
+            windowOptions = true;
+        } else if ((arg == "-r" || arg == "--region") && i + 1 < argc) {
+            regions.push_back(argv[++i]);
+        } else if (filename.empty()) {
+            filename = arg;
+        } else {
+            usage = true;
+        }
+    }
+
+    // Regions are reported as per-record totals; windows over them are not
+    // supported
+    usage |= !regions.empty() && windowOptions;
+
+    if (usage || filename.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [-t <threads>] [--stream] [-w <window> [-s <step>]] [-r <region>]... <FASTA file | ->" << std::endl;
+        std::cerr << "  -t, --threads N   count in parallel on N threads (0 = all cores)" << std::endl;
+        std::cerr << "  --stream          read sequentially in fixed memory instead of mapping the file;" << std::endl;
+        std::cerr << "                    implied for stdin (-) and gzip/BGZF input" << std::endl;
+        std::cerr << "  -w, --window N    report GC in windows of N bases instead of per record" << std::endl;
+        std::cerr << "  -s, --step N      start a window every N bases (default: the window size)" << std::endl;
+        std::cerr << "  --format F        window output: bedgraph (default) or binary" << std::endl;
+        std::cerr << "  -o, --output FILE write the window track to FILE instead of stdout" << std::endl;
+        std::cerr << "  -r, --region R    only count record or region R (\"chr\", \"chr:start-end\", 1-based);" << std::endl;
+        std::cerr << "                    repeatable, uses <FASTA file>.fai, building it if needed;" << std::endl;
+        std::cerr << "                    not combined with -w, -s, --format or -o" << std::endl;
         return 1;
     }
 
@@ -98,7 +233,24 @@ int main(int argc, char* argv[]) {
     signal(SIGINT, signalHandler);
 
     // Process the file
-    processFile(argv[1]);
+    try {
+        if (!regions.empty()) {
+            processRegions(filename, regions, threads);
+        } else if (window != 0) {
+            bool streamWindows = stream || filename == "-" || isGzipFile(filename);
+            processFileWindows(filename, streamWindows, threads, window, step == 0 ? window : step, format,
+                               outputFile);
+        } else if (stream || filename == "-" || isGzipFile(filename)) {
+            processStream(filename, threads);
+        } else if (parallel) {
+            processFileParallel(filename, threads);
+        } else {
+            processFile(filename);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
 
     return 0;
 }
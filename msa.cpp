@@ -0,0 +1,133 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstdlib>
+#include "fasta_reader.hpp"
+#include "dna_sequence.hpp"
+#include "progressive_alignment.hpp"
+
+// Progressive multiple alignment of every record of a FASTA file, written
+// in CLUSTAL format
+
+int main(int argc, char* argv[]) {
+    std::string inputFile, outputFile, treeFile;
+    DistanceMethod distanceMethod = DistanceMethod::Auto;
+    GuideTreeMethod treeMethod = GuideTreeMethod::Upgma;
+    bool treeOrder = false;
+    size_t threads = 0;
+    size_t memoryBudget = DEFAULT_MEMORY_BUDGET;
+    ScoringScheme scoring;
+    bool usage = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (parseScoringOption(argc, argv, i, scoring)) {
+            continue;
+        } else if (arg == "--tree" && i + 1 < argc) {
+            std::string method = argv[++i];
+            if (method == "upgma") {
+                treeMethod = GuideTreeMethod::Upgma;
+            } else if (method == "nj") {
+                treeMethod = GuideTreeMethod::NeighborJoining;
+            } else {
+                usage = true;
+            }
+        } else if (arg == "--distance" && i + 1 < argc) {
+            std::string method = argv[++i];
+            if (method == "auto") {
+                distanceMethod = DistanceMethod::Auto;
+            } else if (method == "align") {
+                distanceMethod = DistanceMethod::Alignment;
+            } else if (method == "kmer") {
+                distanceMethod = DistanceMethod::Kmer;
+            } else {
+                usage = true;
+            }
+        } else if (arg == "--tree-order") {
+            treeOrder = true;
+        } else if (arg == "--guide-tree" && i + 1 < argc) {
+            treeFile = argv[++i];
+        } else if (arg == "--memory-budget" && i + 1 < argc) {
+            memoryBudget = std::strtoull(argv[++i], nullptr, 10) << 20;  // MiB
+        } else if ((arg == "-t" || arg == "--threads") && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);  // 0 = all cores
+        } else if ((arg == "-o" || arg == "--output") && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else if (inputFile.empty()) {
+            inputFile = arg;
+        } else {
+            usage = true;
+        }
+    }
+
+    if (usage || inputFile.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--tree upgma|nj] [--distance auto|align|kmer] [--tree-order]"
+                  << " [--guide-tree <file>] [--memory-budget <MiB>] [-t <threads>] [-o <file>]"
+                  << " [--gap-open <cost>] [--gap-extend <cost>] <sequences.fa>" << std::endl;
+        std::cerr << "ex: " << argv[0] << " panel.fa -o panel.aln" << std::endl;
+        std::cerr << "Aligns every record of the file and writes the alignment in CLUSTAL format." << std::endl;
+        std::cerr << "--distance: align scores each pair by the identity of its Needleman-Wunsch alignment,"
+                  << " kmer by shared " << MSA_KMER_LENGTH << "-mers; auto aligns unless that exceeds "
+                  << (MSA_ALIGNMENT_DISTANCE_CELLS >> 30) << " Gi DP cells in total." << std::endl;
+        std::cerr << "--tree picks the guide tree (default upgma); --tree-order lists the rows in guide-tree"
+                  << " order instead of input order; --guide-tree F writes the tree in Newick format." << std::endl;
+        std::cerr << "Each profile-profile alignment keeps a full traceback matrix, about 0.5 byte per column pair;"
+                  << " alignments over the memory budget (" << (DEFAULT_MEMORY_BUDGET >> 20)
+                  << " MiB by default) fail, e.g. two 60 kbp profiles need about 1.8 GB." << std::endl;
+        std::cerr << "-t N runs on N threads (0 = all cores, the default)." << std::endl;
+        return 1;
+    }
+
+    try {
+        std::vector<std::string> names;
+        std::vector<DnaSequence> sequences;
+        FastaReader reader(inputFile);
+        FastaRecord record;
+        while (reader.next(record)) {
+            if (record.empty()) continue;
+            names.emplace_back(record.name());
+            sequences.emplace_back();
+            sequences.back().appendRecord(record);
+        }
+        if (sequences.empty()) {
+            throw std::runtime_error("No sequences in " + inputFile);
+        }
+
+        ProgressiveAligner aligner;
+        aligner.setScoring(scoring);
+        aligner.setDistanceMethod(distanceMethod);
+        aligner.setTreeMethod(treeMethod);
+        aligner.setThreads(threads);
+        aligner.setMemoryBudget(memoryBudget);
+        std::vector<std::string> rows = aligner.align(sequences);
+
+        std::vector<size_t> order(rows.size());
+        for (size_t k = 0; k < order.size(); ++k) order[k] = k;
+        if (treeOrder) order = aligner.guideTree().leafOrder();
+
+        if (!treeFile.empty()) {
+            std::ofstream tree(treeFile);
+            if (!tree) {
+                throw std::runtime_error("Cannot open file: " + treeFile);
+            }
+            tree << aligner.guideTree().newick(names) << "\n";
+        }
+
+        if (outputFile.empty()) {
+            writeClustal(std::cout, names, rows, order);
+        } else {
+            std::ofstream out(outputFile);
+            if (!out) {
+                throw std::runtime_error("Cannot open file: " + outputFile);
+            }
+            writeClustal(out, names, rows, order);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,632 @@
+#ifndef PROGRESSIVE_ALIGNMENT_HPP
+#define PROGRESSIVE_ALIGNMENT_HPP
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <future>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+#include <cctype>
+#include "dna_sequence.hpp"
+#include "alignment_scoring.hpp"
+#include "alignment_wavefront.hpp"
+#include "thread_pool.hpp"
+#include "alignment_visualization/needleman_wunsch.hpp"
+
+// Progressive multiple sequence alignment, Clustal style:
+//   1. a distance for every pair of sequences, computed on a thread pool:
+//      1 - identity of the aligned columns of their Needleman-Wunsch
+//      alignment, or for large inputs the fraction of k-mers they do not
+//      share, which needs no DP at all
+//   2. a guide tree over the distances, UPGMA or neighbor-joining
+//   3. from the leaves up, the two profiles (sets of gapped rows) under a
+//      node aligned column against column with the Gotoh recurrences of the
+//      pairwise aligners. A gap put into a profile goes into all its rows
+//      and stays there.
+// Nodes whose children are aligned do not depend on each other, so the
+// tree is aligned level by level, one task per node. A level with a single
+// node fills its matrix as a wavefront on the same pool instead.
+//
+// Each profile-profile step keeps a full traceback matrix, about half a byte
+// per column pair, so two 60 kbp profiles need some 1.8 GB. There is no
+// linear-space fallback: a step over the memory budget (setMemoryBudget,
+// DEFAULT_MEMORY_BUDGET by default) fails with an error, and nodes of one
+// level are only aligned side by side while their matrices fit in it
+// together.
+
+// Bases per k-mer of the k-mer distance
+const size_t MSA_KMER_LENGTH = 6;
+
+// Auto distances align every pair while all the pairs together stay under
+// this many DP cells, and count k-mers beyond it
+const size_t MSA_ALIGNMENT_DISTANCE_CELLS = size_t(1) << 32;
+
+// Profile column scores are fractions of a substitution score; they and the
+// gap costs are scaled by this for the integer DP
+const int PROFILE_SCALE = 100;
+
+// How the pairwise distances are computed
+enum class DistanceMethod {
+    Auto,       // Alignment up to MSA_ALIGNMENT_DISTANCE_CELLS, then Kmer
+    Alignment,  // 1 - matches / (matches + mismatches) of a global alignment
+    Kmer        // 1 - shared k-mers / k-mers of the shorter sequence
+};
+
+enum class GuideTreeMethod {
+    Upgma,           // average linkage; ultrametric, joins the closest pair
+    NeighborJoining  // corrects for unequal rates; rooted at the last join
+};
+
+// Sorted codes of the k-mers of bases that hold only A, C, G and T (case
+// ignored), 2 bits per base
+inline std::vector<uint32_t> kmerCodes(const std::string& bases, size_t k) {
+    std::vector<uint32_t> codes;
+    const uint32_t mask = static_cast<uint32_t>((uint64_t(1) << (2 * k)) - 1);
+    uint32_t code = 0;
+    size_t valid = 0;  // bases since the last non-ACGT character
+    for (char base : bases) {
+        int value = dnaCode(base);
+        if (value < 0) {
+            valid = 0;
+            continue;
+        }
+        code = ((code << 2) | static_cast<uint32_t>(value)) & mask;
+        if (++valid >= k) codes.push_back(code);
+    }
+    std::sort(codes.begin(), codes.end());
+    return codes;
+}
+
+// 1 - shared k-mers / k-mers of the shorter sequence, counted with
+// multiplicity; 1 when either has no k-mers
+inline double kmerDistance(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+    size_t fewer = std::min(a.size(), b.size());
+    if (fewer == 0) return 1.0;
+    size_t shared = 0;
+    for (size_t x = 0, y = 0; x < a.size() && y < b.size();) {
+        if (a[x] < b[y]) {
+            ++x;
+        } else if (b[y] < a[x]) {
+            ++y;
+        } else {
+            ++shared;
+            ++x;
+            ++y;
+        }
+    }
+    return 1.0 - static_cast<double>(shared) / fewer;
+}
+
+using DistanceMatrix = std::vector<std::vector<double> >;
+
+// Rooted binary tree over the sequences: nodes 0 .. leaves-1 are the
+// sequences, the following ones the joins in the order they were made, so
+// children always come before their parent and the root is last
+struct GuideTree {
+    static const size_t NONE = SIZE_MAX;
+    struct Node {
+        size_t left = NONE, right = NONE;
+    };
+    std::vector<Node> nodes;
+    size_t leaves = 0;
+
+    size_t root() const { return nodes.size() - 1; }
+    bool isLeaf(size_t node) const { return node < leaves; }
+
+    void join(size_t left, size_t right) {
+        Node node;
+        node.left = left;
+        node.right = right;
+        nodes.push_back(node);
+    }
+
+    // Sequences from left to right
+    std::vector<size_t> leafOrder() const {
+        std::vector<size_t> order, stack{root()};
+        while (!stack.empty()) {
+            size_t node = stack.back();
+            stack.pop_back();
+            if (isLeaf(node)) {
+                order.push_back(node);
+            } else {
+                stack.push_back(nodes[node].right);
+                stack.push_back(nodes[node].left);
+            }
+        }
+        return order;
+    }
+
+    // Newick text of the topology, leaves named by names
+    std::string newick(const std::vector<std::string>& names) const {
+        std::string text;
+        appendNewick(root(), names, text);
+        return text + ";";
+    }
+
+private:
+    void appendNewick(size_t node, const std::vector<std::string>& names, std::string& text) const {
+        if (isLeaf(node)) {
+            text += names[node];
+            return;
+        }
+        text += '(';
+        appendNewick(nodes[node].left, names, text);
+        text += ',';
+        appendNewick(nodes[node].right, names, text);
+        text += ')';
+    }
+};
+
+// UPGMA: join the closest pair of clusters, the distance to the new
+// cluster is the size-weighted mean of the two. O(n^3), ties go to the
+// first pair in row-major order.
+inline GuideTree buildUpgmaTree(DistanceMatrix d) {
+    size_t n = d.size();
+    GuideTree tree;
+    tree.leaves = n;
+    tree.nodes.resize(n);
+    std::vector<size_t> node(n), size(n, 1), active(n);
+    std::iota(node.begin(), node.end(), 0);
+    std::iota(active.begin(), active.end(), 0);
+
+    while (active.size() > 1) {
+        size_t bestX = 0, bestY = 1;
+        double best = std::numeric_limits<double>::infinity();
+        for (size_t x = 0; x < active.size(); ++x) {
+            for (size_t y = x + 1; y < active.size(); ++y) {
+                if (d[active[x]][active[y]] < best) {
+                    best = d[active[x]][active[y]];
+                    bestX = x;
+                    bestY = y;
+                }
+            }
+        }
+        size_t a = active[bestX], b = active[bestY];
+        tree.join(node[a], node[b]);
+        for (size_t c : active) {
+            if (c == a || c == b) continue;
+            d[a][c] = d[c][a] = (d[a][c] * size[a] + d[b][c] * size[b]) / (size[a] + size[b]);
+        }
+        size[a] += size[b];
+        node[a] = tree.nodes.size() - 1;
+        active.erase(active.begin() + bestY);
+    }
+    return tree;
+}
+
+// Saitou and Nei's neighbor-joining: join the pair minimizing
+// Q(a, b) = (r - 2) d(a, b) - sum d(a, .) - sum d(b, .) over the r active
+// clusters. The unrooted result is rooted where the last two clusters meet.
+inline GuideTree buildNeighborJoiningTree(DistanceMatrix d) {
+    size_t n = d.size();
+    GuideTree tree;
+    tree.leaves = n;
+    tree.nodes.resize(n);
+    std::vector<size_t> node(n), active(n);
+    std::iota(node.begin(), node.end(), 0);
+    std::iota(active.begin(), active.end(), 0);
+    std::vector<double> sums(n);
+
+    while (active.size() > 1) {
+        size_t bestX = 0, bestY = 1;
+        if (active.size() > 2) {
+            for (size_t c : active) {
+                sums[c] = 0;
+                for (size_t other : active) sums[c] += d[c][other];
+            }
+            double r = static_cast<double>(active.size());
+            double best = std::numeric_limits<double>::infinity();
+            for (size_t x = 0; x < active.size(); ++x) {
+                for (size_t y = x + 1; y < active.size(); ++y) {
+                    size_t a = active[x], b = active[y];
+                    double q = (r - 2) * d[a][b] - sums[a] - sums[b];
+                    if (q < best) {
+                        best = q;
+                        bestX = x;
+                        bestY = y;
+                    }
+                }
+            }
+        }
+        size_t a = active[bestX], b = active[bestY];
+        tree.join(node[a], node[b]);
+        for (size_t c : active) {
+            if (c == a || c == b) continue;
+            d[a][c] = d[c][a] = (d[a][c] + d[b][c] - d[a][b]) / 2;
+        }
+        node[a] = tree.nodes.size() - 1;
+        active.erase(active.begin() + bestY);
+    }
+    return tree;
+}
+
+// Sequences aligned so far: input indices and gapped rows of equal length
+struct Profile {
+    std::vector<size_t> members;
+    std::vector<std::string> rows;
+
+    size_t length() const { return rows.empty() ? 0 : rows[0].size(); }
+};
+
+class ProgressiveAligner {
+private:
+    // Share of the rows holding A, C, G, T and any residue in one column,
+    // pre-multiplied by the substitution scores on the row side
+    struct ColumnWeights {
+        float base[4];
+        float residues;
+        float occupancy;  // share of rows with a residue, unscaled
+    };
+
+    // Sum-of-pairs gap costs: a gap run opposite a column pairs a gap with
+    // only the column's residues, so it costs the gap cost times the
+    // column's occupancy. Index 0 is unused, as in the DP.
+    struct ProfileGapCosts {
+        std::vector<int> upOpen, upExtend, leftOpen, leftExtend;
+
+        int openUp(size_t i) const { return upOpen[i]; }
+        int extendUp(size_t i) const { return upExtend[i]; }
+        int openLeft(size_t j) const { return leftOpen[j]; }
+        int extendLeft(size_t j) const { return leftExtend[j]; }
+    };
+
+    ScoringScheme scoring;
+    DistanceMethod distanceMethod = DistanceMethod::Auto;
+    GuideTreeMethod treeMethod = GuideTreeMethod::Upgma;
+    size_t threads = 0;
+    size_t memoryBudget = DEFAULT_MEMORY_BUDGET;
+    bool usedKmers = false;
+    GuideTree tree;
+
+    DistanceMatrix alignmentDistances(const std::vector<DnaSequence>& sequences, ThreadPool& pool) const {
+        size_t n = sequences.size();
+        DistanceMatrix d(n, std::vector<double>(n, 0.0));
+        std::vector<NeedlemanWunsch> aligners(pool.size());
+        for (NeedlemanWunsch& nw : aligners) {
+            nw.setScoring(scoring);
+            nw.setMemoryBudget(DEFAULT_MEMORY_BUDGET / pool.size());
+        }
+        runRows(pool, n, [&](size_t i) {
+            NeedlemanWunsch& nw = aligners[pool.workerIndex()];
+            for (size_t j = i + 1; j < n; ++j) {
+                nw.setSequences(sequences[i], sequences[j]);
+                nw.align();
+                const AlignmentStats& stats = nw.cigar().stats();
+                size_t aligned = stats.matches + stats.mismatches;
+                d[i][j] = d[j][i] = aligned == 0 ? 1.0 : 1.0 - static_cast<double>(stats.matches) / aligned;
+            }
+        });
+        return d;
+    }
+
+    DistanceMatrix kmerDistances(const std::vector<DnaSequence>& sequences, ThreadPool& pool) const {
+        size_t n = sequences.size();
+        std::vector<std::vector<uint32_t> > kmers(n);
+        runRows(pool, n, [&](size_t i) { kmers[i] = kmerCodes(sequences[i].str(), MSA_KMER_LENGTH); });
+
+        DistanceMatrix d(n, std::vector<double>(n, 0.0));
+        runRows(pool, n, [&](size_t i) {
+            for (size_t j = i + 1; j < n; ++j) {
+                d[i][j] = d[j][i] = kmerDistance(kmers[i], kmers[j]);
+            }
+        });
+        return d;
+    }
+
+    // row(i) for i in [0, n) on pool; every task is waited for before the
+    // first failure is rethrown, as they share the caller's data
+    template <typename Row>
+    static void runRows(ThreadPool& pool, size_t n, Row&& row) {
+        std::vector<std::future<void> > running;
+        running.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            running.push_back(pool.submit([&row, i] { row(i); }));
+        }
+        std::exception_ptr error;
+        for (std::future<void>& task : running) {
+            try {
+                task.get();
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+        }
+        if (error) std::rethrow_exception(error);
+    }
+
+    // Column weights of a profile; the row side (scaled) carries the
+    // substitution scores so a column pair costs five multiplies
+    std::vector<ColumnWeights> columnWeights(const Profile& profile, bool scaled) const {
+        std::vector<ColumnWeights> columns(profile.length());
+        float share = 1.0f / profile.rows.size();
+        float baseScale = scaled ? static_cast<float>(PROFILE_SCALE * (scoring.match - scoring.mismatch)) : 1.0f;
+        float residueScale = scaled ? static_cast<float>(PROFILE_SCALE * scoring.mismatch) : 1.0f;
+        for (size_t k = 0; k < columns.size(); ++k) {
+            size_t counts[4] = {0, 0, 0, 0};
+            size_t residues = 0;
+            for (const std::string& row : profile.rows) {
+                if (row[k] == '-') continue;
+                ++residues;
+                int code = dnaCode(row[k]);
+                if (code >= 0) ++counts[code];
+            }
+            for (int c = 0; c < 4; ++c) columns[k].base[c] = baseScale * share * counts[c];
+            columns[k].residues = residueScale * share * residues;
+            columns[k].occupancy = share * residues;
+        }
+        return columns;
+    }
+
+    // Scaled costs of a gap opposite each column, rounded but never below
+    // 1 so a gap is never free
+    void scaleGapCosts(const std::vector<ColumnWeights>& columns, std::vector<int>& open,
+                       std::vector<int>& extend) const {
+        open.assign(columns.size() + 1, 0);
+        extend.assign(columns.size() + 1, 0);
+        for (size_t k = 0; k < columns.size(); ++k) {
+            float occupancy = columns[k].occupancy * PROFILE_SCALE;
+            open[k + 1] = std::max(1, static_cast<int>(occupancy * scoring.gapOpen + 0.5f));
+            extend[k + 1] = std::max(1, static_cast<int>(occupancy * scoring.gapExtend + 0.5f));
+        }
+    }
+
+    // Align two profiles and merge them. The DP is Needleman-Wunsch's Gotoh
+    // fill with end gaps free (row 0, column 0 and the best cell of the last
+    // row or column), so a fragment is not pulled apart to reach the ends.
+    // A column pair scores the mean substitution score over all pairs of
+    // rows, pairs with a gap already in the column counting 0; new gaps cost
+    // as in ProfileGapCosts.
+    Profile alignProfiles(const Profile& a, const Profile& b, ThreadPool* pool) const {
+        size_t n = a.length(), m = b.length();
+        size_t bytes = TracebackMatrix::bytesFor(n, m);
+        if (bytes > memoryBudget) {
+            throw std::runtime_error("Aligning profiles of " + std::to_string(n) + " and " + std::to_string(m) +
+                                     " columns needs " + std::to_string((bytes + (1 << 20) - 1) >> 20) +
+                                     " MiB, over the memory budget of " + std::to_string(memoryBudget >> 20) +
+                                     " MiB");
+        }
+        std::vector<ColumnWeights> rowWeights = columnWeights(a, true), colWeights = columnWeights(b, false);
+        ProfileGapCosts gaps;
+        scaleGapCosts(rowWeights, gaps.upOpen, gaps.upExtend);
+        scaleGapCosts(colWeights, gaps.leftOpen, gaps.leftExtend);
+
+        TracebackMatrix trace;
+        trace.reset(n, m);
+        GotohEdges edges;
+        edges.h.assign(m + 1, 0);
+        edges.e.assign(m + 1, NEG_INF);
+        edges.hLeft.assign(n + 1, 0);
+        edges.f.assign(n + 1, NEG_INF);
+        edges.corner.assign(n + 1, 0);
+        for (size_t j = 1; j <= m; ++j) trace.set(0, j, 'L', EXTEND_LEFT);
+        for (size_t i = 1; i <= n; ++i) trace.set(i, 0, 'U', EXTEND_UP);
+
+        auto substitution = [&rowWeights, &colWeights](size_t i, size_t j) {
+            const ColumnWeights& x = rowWeights[i - 1];
+            const ColumnWeights& y = colWeights[j - 1];
+            float score = x.residues * y.residues + x.base[0] * y.base[0] + x.base[1] * y.base[1] +
+                          x.base[2] * y.base[2] + x.base[3] * y.base[3];
+            return static_cast<int>(score < 0 ? score - 0.5f : score + 0.5f);
+        };
+        bool parallel = pool && n * m >= WAVEFRONT_MIN_CELLS;
+        runWavefront(parallel ? pool : nullptr, n, m, parallel ? WAVEFRONT_TILE : std::max(n, m),
+                     [&](size_t i0, size_t i1, size_t j0, size_t j1) {
+            fillGotohTile<false>(trace, substitution, gaps, edges, i0, i1, j0, j1);
+        });
+
+        // Best end cell: the corner, else the first best of the last row
+        // (edges.h) or the last column (edges.hLeft)
+        size_t endI = n, endJ = m;
+        int best = edges.h[m];
+        for (size_t j = 0; j < m; ++j) {
+            if (edges.h[j] > best) {
+                best = edges.h[j];
+                endI = n;
+                endJ = j;
+            }
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (edges.hLeft[i] > best) {
+                best = edges.hLeft[i];
+                endI = i;
+                endJ = m;
+            }
+        }
+
+        // Columns from the end: 'M' a column of each, 'I' a column of a
+        // against gaps, 'D' a column of b against gaps
+        std::string ops(m - endJ, 'D');
+        ops.append(n - endI, 'I');
+        size_t i = endI, j = endJ;
+        char state = 'H';
+        while (i > 0 || j > 0) {
+            Cell cell = trace(i, j);
+            if (state == 'H') {
+                if (cell.direction == 'D' && i > 0 && j > 0) {
+                    ops += 'M';
+                    i--; j--;
+                    continue;
+                }
+                state = (cell.direction == 'U' && i > 0) || j == 0 ? 'U' : 'L';
+            }
+            if (state == 'U' && i == 0) state = 'L';
+            if (state == 'L' && j == 0) state = 'U';
+            if (state == 'U') {
+                ops += 'I';
+                state = (cell.flags & EXTEND_UP) ? 'U' : 'H';
+                i--;
+            } else {
+                ops += 'D';
+                state = (cell.flags & EXTEND_LEFT) ? 'L' : 'H';
+                j--;
+            }
+        }
+        std::reverse(ops.begin(), ops.end());
+
+        Profile merged;
+        merged.members = a.members;
+        merged.members.insert(merged.members.end(), b.members.begin(), b.members.end());
+        merged.rows.reserve(merged.members.size());
+        for (const std::string& row : a.rows) merged.rows.push_back(expandRow(row, ops, 'D'));
+        for (const std::string& row : b.rows) merged.rows.push_back(expandRow(row, ops, 'I'));
+        return merged;
+    }
+
+    // row with a gap at every column whose op is gapOp
+    static std::string expandRow(const std::string& row, const std::string& ops, char gapOp) {
+        std::string expanded;
+        expanded.reserve(ops.size());
+        size_t k = 0;
+        for (char op : ops) expanded += op == gapOp ? '-' : row[k++];
+        return expanded;
+    }
+
+    // Pairwise distances by the chosen method; Auto picks by total DP cells
+    DistanceMatrix distances(const std::vector<DnaSequence>& sequences, ThreadPool& pool) {
+        usedKmers = distanceMethod == DistanceMethod::Kmer;
+        if (distanceMethod == DistanceMethod::Auto) {
+            double cells = 0;
+            for (size_t i = 0; i < sequences.size(); ++i) {
+                for (size_t j = i + 1; j < sequences.size(); ++j) {
+                    cells += static_cast<double>(sequences[i].length()) * sequences[j].length();
+                }
+            }
+            usedKmers = cells > static_cast<double>(MSA_ALIGNMENT_DISTANCE_CELLS);
+        }
+        return usedKmers ? kmerDistances(sequences, pool) : alignmentDistances(sequences, pool);
+    }
+
+public:
+    void setScoring(const ScoringScheme& newScoring) {
+        newScoring.validate();
+        scoring = newScoring;
+    }
+
+    void setDistanceMethod(DistanceMethod method) { distanceMethod = method; }
+    void setTreeMethod(GuideTreeMethod method) { treeMethod = method; }
+
+    // Worker threads (0 = all cores); the alignment is the same for any count
+    void setThreads(size_t count) { threads = count; }
+
+    // Bytes of traceback matrices held at once while aligning profiles
+    void setMemoryBudget(size_t bytes) { memoryBudget = bytes; }
+
+    // Gapped rows of the multiple alignment, in input order
+    std::vector<std::string> align(const std::vector<DnaSequence>& sequences) {
+        if (sequences.empty()) return {};
+        ThreadPool pool(threads == 0 ? ThreadPool::defaultThreadCount() : threads);
+        DistanceMatrix d = distances(sequences, pool);
+        tree = treeMethod == GuideTreeMethod::Upgma ? buildUpgmaTree(std::move(d))
+                                                    : buildNeighborJoiningTree(std::move(d));
+
+        // Level of a node: leaves 0, a join one above its higher child
+        std::vector<Profile> profiles(tree.nodes.size());
+        std::vector<size_t> level(tree.nodes.size(), 0);
+        std::vector<std::vector<size_t> > levels(1);
+        for (size_t node = 0; node < tree.nodes.size(); ++node) {
+            if (tree.isLeaf(node)) {
+                profiles[node].members.push_back(node);
+                profiles[node].rows.push_back(sequences[node].str());
+                continue;
+            }
+            level[node] = 1 + std::max(level[tree.nodes[node].left], level[tree.nodes[node].right]);
+            if (level[node] >= levels.size()) levels.resize(level[node] + 1);
+            levels[level[node]].push_back(node);
+        }
+
+        auto alignNode = [&](size_t node, ThreadPool* fillPool) {
+            Profile& left = profiles[tree.nodes[node].left];
+            Profile& right = profiles[tree.nodes[node].right];
+            profiles[node] = alignProfiles(left, right, fillPool);
+            left = Profile();
+            right = Profile();
+        };
+        auto nodeBytes = [&](size_t node) {
+            return TracebackMatrix::bytesFor(profiles[tree.nodes[node].left].length(),
+                                             profiles[tree.nodes[node].right].length());
+        };
+        for (size_t k = 1; k < levels.size(); ++k) {
+            // Nodes of the level in batches whose matrices fit the budget
+            // together
+            const std::vector<size_t>& nodes = levels[k];
+            for (size_t first = 0; first < nodes.size();) {
+                size_t last = first + 1;
+                size_t bytes = nodeBytes(nodes[first]);
+                while (last < nodes.size() && bytes + nodeBytes(nodes[last]) <= memoryBudget) {
+                    bytes += nodeBytes(nodes[last++]);
+                }
+                if (last - first == 1) {
+                    alignNode(nodes[first], &pool);
+                } else {
+                    runRows(pool, last - first, [&](size_t x) { alignNode(nodes[first + x], nullptr); });
+                }
+                first = last;
+            }
+        }
+
+        const Profile& result = profiles[tree.root()];
+        std::vector<std::string> rows(sequences.size());
+        for (size_t k = 0; k < result.members.size(); ++k) {
+            rows[result.members[k]] = result.rows[k];
+        }
+        return rows;
+    }
+
+    // Guide tree of the last align()
+    const GuideTree& guideTree() const { return tree; }
+
+    // Whether the last distances were k-mer distances
+    bool usedKmerDistances() const { return usedKmers; }
+};
+
+// CLUSTAL alignment format: blocks of lineLength columns, each row the name
+// padded to a common width, the columns and the row's residue count so far,
+// then the conservation line ('*' where every row has the same residue)
+inline void writeClustal(std::ostream& out, const std::vector<std::string>& names,
+                         const std::vector<std::string>& rows, const std::vector<size_t>& order,
+                         size_t lineLength = 60) {
+    size_t nameWidth = 10;
+    for (size_t k : order) nameWidth = std::max(nameWidth, names[k].size() + 1);
+    size_t length = rows.empty() ? 0 : rows[order[0]].size();
+
+    std::string text = "CLUSTAL multiple sequence alignment\n\n\n";
+    std::vector<size_t> residues(rows.size(), 0);
+    for (size_t start = 0; start < length; start += lineLength) {
+        size_t columns = std::min(lineLength, length - start);
+        for (size_t k : order) {
+            text += names[k];
+            text.append(nameWidth - names[k].size(), ' ');
+            text.append(rows[k], start, columns);
+            size_t before = residues[k];
+            for (size_t c = start; c < start + columns; ++c) {
+                if (rows[k][c] != '-') ++residues[k];
+            }
+            if (residues[k] > before) {
+                text += '\t';
+                text += std::to_string(residues[k]);
+            }
+            text += '\n';
+        }
+
+        text.append(nameWidth, ' ');
+        for (size_t c = start; c < start + columns; ++c) {
+            char first = static_cast<char>(std::toupper(static_cast<unsigned char>(rows[order[0]][c])));
+            bool conserved = first != '-';
+            for (size_t x = 1; x < order.size() && conserved; ++x) {
+                conserved = std::toupper(static_cast<unsigned char>(rows[order[x]][c])) == first;
+            }
+            text += conserved ? '*' : ' ';
+        }
+        text += "\n\n";
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        text.clear();
+    }
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+#endif
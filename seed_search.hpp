@@ -0,0 +1,375 @@
+#ifndef SEED_SEARCH_HPP
+#define SEED_SEARCH_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <future>
+#include <memory>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include "dna_sequence.hpp"
+#include "alignment_scoring.hpp"
+#include "alignment_cigar.hpp"
+#include "smith_waterman.hpp"
+#include "thread_pool.hpp"
+
+// Seed-and-extend local alignment against targets far too long for a full
+// Smith-Waterman matrix (chromosomes, whole assemblies):
+//   1. index: the (w, k)-minimizers of every target record, sorted by hash;
+//      a minimizer is the k-mer with the smallest hash in a window of w
+//      consecutive k-mers, so about 2 / (w + 1) of the k-mers are kept and
+//      two sequences sharing w + k - 1 bases share a minimizer
+//   2. seeds: the query's minimizers looked up in the index, each hit a
+//      (query, target) position pair on diagonal target - query.
+//      Minimizers occurring more than maxOccurrences times are repeats and
+//      are skipped.
+//   3. chains: seeds sorted by diagonal and grouped while the diagonal
+//      drifts at most band per seed, then split where the target positions
+//      are more than maxGap apart
+//   4. extension: SmithWaterman of the whole query against the target
+//      window the chain's diagonals project it onto, widened by band
+// The DP runs only over the windows, so a query costs its length times the
+// window lengths rather than times the target. Reverse-strand hits come
+// from searching the query's reverse complement.
+
+struct SeedOptions {
+    size_t k = 15;                // k-mer length, 1..31
+    size_t w = 10;                // k-mers per minimizer window; 1 indexes every k-mer
+    size_t maxOccurrences = 500;  // minimizers more frequent in the target are ignored
+    size_t minSeeds = 2;          // seeds a chain needs to be extended
+    size_t band = 100;            // diagonal drift within a chain, and margin of its window
+    size_t maxGap = 5000;         // target bases between consecutive seeds of a chain
+    size_t maxChains = 50;        // chains extended per query and strand, most seeds first
+    size_t topHits = 10;          // hits reported per query
+
+    void validate() const {
+        if (k < 1 || k > 31) throw std::runtime_error("Seed k-mer length must be between 1 and 31");
+        if (w < 1) throw std::runtime_error("Minimizer window must be at least 1");
+    }
+};
+
+// Invertible mix of a k-mer code within mask (Thomas Wang's 64-bit hash),
+// so minimizers are not biased towards poly-A
+inline uint64_t hashKmer(uint64_t key, uint64_t mask) {
+    key = (~key + (key << 21)) & mask;
+    key = key ^ key >> 24;
+    key = ((key + (key << 3)) + (key << 8)) & mask;
+    key = key ^ key >> 14;
+    key = ((key + (key << 2)) + (key << 4)) & mask;
+    key = key ^ key >> 28;
+    key = (key + (key << 31)) & mask;
+    return key;
+}
+
+// Call emit(hash, position) for each (w, k)-minimizer of bases, position
+// being where the k-mer starts. K-mers holding characters other than
+// A/C/G/T are skipped; a stretch of fewer than w k-mers between them still
+// gets its smallest one. Ties go to the leftmost k-mer, and a k-mer that is
+// the minimizer of several windows is emitted once.
+template <typename Emit>
+void forEachMinimizer(std::string_view bases, size_t k, size_t w, Emit&& emit) {
+    struct Candidate {
+        uint64_t hash;
+        size_t position;
+    };
+    const uint64_t mask = (uint64_t(1) << (2 * k)) - 1;
+    std::deque<Candidate> window;  // increasing hashes, positions in order
+    uint64_t code = 0;
+    size_t valid = 0;  // bases since the last ambiguous one
+    size_t kmers = 0;  // k-mers since the last ambiguous base
+    size_t lastEmitted = SIZE_MAX;
+
+    auto endStretch = [&]() {
+        if (kmers > 0 && kmers < w && window.front().position != lastEmitted) {
+            emit(window.front().hash, window.front().position);
+        }
+        window.clear();
+        valid = kmers = 0;
+    };
+
+    for (size_t i = 0; i < bases.size(); ++i) {
+        int value = dnaCode(bases[i]);
+        if (value < 0) {
+            endStretch();
+            continue;
+        }
+        code = ((code << 2) | static_cast<uint64_t>(value)) & mask;
+        if (++valid < k) continue;
+
+        Candidate kmer{hashKmer(code, mask), i + 1 - k};
+        while (!window.empty() && window.back().hash > kmer.hash) window.pop_back();
+        window.push_back(kmer);
+        ++kmers;
+        if (window.front().position + w <= kmer.position) window.pop_front();
+        if (kmers >= w && window.front().position != lastEmitted) {
+            lastEmitted = window.front().position;
+            emit(window.front().hash, lastEmitted);
+        }
+    }
+    endStretch();
+}
+
+// Minimizer index of a set of target records
+class SeedIndex {
+public:
+    // One minimizer occurrence in the targets
+    struct Entry {
+        uint64_t hash;
+        uint32_t record;
+        uint32_t position;
+
+        bool operator<(const Entry& other) const {
+            return hash != other.hash ? hash < other.hash
+                 : record != other.record ? record < other.record : position < other.position;
+        }
+    };
+
+private:
+    std::vector<Entry> entries;  // sorted by hash, then target position
+    size_t k = 0, w = 0;
+
+public:
+    // Positions of one minimizer in the targets
+    struct Range {
+        const Entry* first = nullptr;
+        const Entry* last = nullptr;
+        size_t size() const { return static_cast<size_t>(last - first); }
+    };
+
+    // Index every record; records are minimized in parallel on pool
+    void build(const std::vector<DnaSequence>& targets, size_t kmerLength, size_t windowKmers, ThreadPool& pool) {
+        k = kmerLength;
+        w = windowKmers;
+        entries.clear();
+        for (const DnaSequence& target : targets) {
+            if (target.length() > UINT32_MAX) {
+                throw std::runtime_error("Target records longer than 4 Gbp are not supported");
+            }
+        }
+        std::vector<std::future<std::vector<Entry> > > parts;
+        for (size_t r = 0; r < targets.size(); ++r) {
+            parts.push_back(pool.submit([this, &targets, r] {
+                std::vector<Entry> part;
+                forEachMinimizer(targets[r].str(), k, w, [&part, r](uint64_t hash, size_t position) {
+                    part.push_back({hash, static_cast<uint32_t>(r), static_cast<uint32_t>(position)});
+                });
+                return part;
+            }));
+        }
+        std::exception_ptr error;
+        for (auto& part : parts) {
+            try {
+                std::vector<Entry> found = part.get();
+                entries.insert(entries.end(), found.begin(), found.end());
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+        }
+        if (error) std::rethrow_exception(error);
+        std::sort(entries.begin(), entries.end());
+    }
+
+    Range lookup(uint64_t hash) const {
+        auto first = std::lower_bound(entries.begin(), entries.end(), hash,
+                                      [](const Entry& entry, uint64_t value) { return entry.hash < value; });
+        auto last = std::upper_bound(first, entries.end(), hash,
+                                     [](uint64_t value, const Entry& entry) { return value < entry.hash; });
+        Range range;
+        range.first = entries.data() + (first - entries.begin());
+        range.last = entries.data() + (last - entries.begin());
+        return range;
+    }
+
+    size_t size() const { return entries.size(); }
+    size_t memoryUsage() const { return entries.capacity() * sizeof(Entry); }
+    size_t kmerLength() const { return k; }
+    size_t windowKmers() const { return w; }
+};
+
+// One local alignment found by the search. The summary's seq2 coordinates
+// are in the target record; on the '-' strand the query coordinates and the
+// CIGAR refer to the query's reverse complement, as in SAM.
+struct SeedHit {
+    size_t target = 0;  // record index
+    char strand = '+';
+    size_t seeds = 0;   // seeds of the chain that led to it
+    AlignmentSummary summary;
+    Cigar cigar;
+};
+
+// Seeds on one target diagonal run, ready to extend
+struct SeedChain {
+    uint32_t target = 0;
+    int64_t minDiagonal = 0, maxDiagonal = 0;  // target - query position
+    size_t seeds = 0;
+};
+
+class SeedSearch {
+private:
+    struct Seed {
+        uint32_t target;
+        int64_t diagonal;
+        uint32_t position;  // in the target
+    };
+
+    const std::vector<DnaSequence>& targets;
+    const SeedIndex& index;
+    SeedOptions options;
+    ThreadPool& pool;
+    std::vector<std::unique_ptr<SmithWaterman> > aligners;  // one per worker of pool
+
+    // Chains of one strand of a query, most seeds first
+    std::vector<SeedChain> chain(std::string_view query) const {
+        std::vector<Seed> seeds;
+        forEachMinimizer(query, index.kmerLength(), index.windowKmers(), [&](uint64_t hash, size_t position) {
+            SeedIndex::Range range = index.lookup(hash);
+            if (range.size() > options.maxOccurrences) return;
+            for (const SeedIndex::Entry* entry = range.first; entry != range.last; ++entry) {
+                seeds.push_back({entry->record, static_cast<int64_t>(entry->position) - static_cast<int64_t>(position),
+                                 entry->position});
+            }
+        });
+        std::sort(seeds.begin(), seeds.end(), [](const Seed& a, const Seed& b) {
+            return a.target != b.target ? a.target < b.target : a.diagonal < b.diagonal;
+        });
+
+        std::vector<SeedChain> chains;
+        auto addChains = [&](size_t from, size_t to) {
+            // A diagonal group split wherever the target positions jump
+            std::sort(seeds.begin() + from, seeds.begin() + to,
+                      [](const Seed& a, const Seed& b) { return a.position < b.position; });
+            size_t start = from;
+            for (size_t s = from + 1; s <= to; ++s) {
+                if (s < to && seeds[s].position - seeds[s - 1].position <= options.maxGap) continue;
+                if (s - start >= options.minSeeds) {
+                    SeedChain found;
+                    found.target = seeds[start].target;
+                    found.minDiagonal = found.maxDiagonal = seeds[start].diagonal;
+                    for (size_t x = start; x < s; ++x) {
+                        found.minDiagonal = std::min(found.minDiagonal, seeds[x].diagonal);
+                        found.maxDiagonal = std::max(found.maxDiagonal, seeds[x].diagonal);
+                    }
+                    found.seeds = s - start;
+                    chains.push_back(found);
+                }
+                start = s;
+            }
+        };
+        size_t groupStart = 0;
+        for (size_t s = 1; s <= seeds.size(); ++s) {
+            if (s < seeds.size() && seeds[s].target == seeds[s - 1].target &&
+                seeds[s].diagonal - seeds[s - 1].diagonal <= static_cast<int64_t>(options.band)) {
+                continue;
+            }
+            addChains(groupStart, s);
+            groupStart = s;
+        }
+
+        std::stable_sort(chains.begin(), chains.end(),
+                         [](const SeedChain& a, const SeedChain& b) { return a.seeds > b.seeds; });
+        if (chains.size() > options.maxChains) chains.resize(options.maxChains);
+        return chains;
+    }
+
+    // Smith-Waterman of the query against the chain's window of its target
+    SeedHit extend(SmithWaterman& sw, const DnaSequence& query, char strand, const SeedChain& found) const {
+        const DnaSequence& target = targets[found.target];
+        int64_t margin = static_cast<int64_t>(options.band);
+        int64_t from = std::max<int64_t>(0, found.minDiagonal - margin);
+        int64_t to = std::min<int64_t>(static_cast<int64_t>(target.length()),
+                                       found.maxDiagonal + static_cast<int64_t>(query.length()) + margin);
+        size_t windowStart = static_cast<size_t>(from);
+        size_t windowLength = to > from ? static_cast<size_t>(to - from) : 0;
+
+        sw.setSequences(query, DnaSequence(target.substr(windowStart, windowLength)));
+        sw.align();
+        SeedHit hit;
+        hit.target = found.target;
+        hit.strand = strand;
+        hit.seeds = found.seeds;
+        hit.summary = sw.summary();
+        hit.cigar = sw.cigar();
+        if (!hit.cigar.empty()) {
+            hit.summary.start2 += windowStart;
+            hit.summary.end2 += windowStart;
+        }
+        return hit;
+    }
+
+    // Whether two hits of the same target and strand cover overlapping
+    // query and target intervals (the same alignment found from two chains)
+    static bool overlaps(const SeedHit& a, const SeedHit& b) {
+        return a.target == b.target && a.strand == b.strand &&
+               a.summary.start1 <= b.summary.end1 && b.summary.start1 <= a.summary.end1 &&
+               a.summary.start2 <= b.summary.end2 && b.summary.start2 <= a.summary.end2;
+    }
+
+public:
+    // Search targets through index; extensions run on pool
+    SeedSearch(const std::vector<DnaSequence>& targetRecords, const SeedIndex& seedIndex,
+               const SeedOptions& seedOptions, const ScoringScheme& scoring, ThreadPool& workers)
+        : targets(targetRecords), index(seedIndex), options(seedOptions), pool(workers) {
+        for (size_t k = 0; k < pool.size(); ++k) {
+            aligners.push_back(std::make_unique<SmithWaterman>());
+            aligners.back()->setScoring(scoring);
+        }
+    }
+
+    // Extend with the scalar full-matrix fill instead of the striped kernel
+    void setStriped(bool enabled) {
+        for (auto& sw : aligners) sw->setStriped(enabled);
+    }
+
+    // Best hits of query on both strands, highest score first, at most
+    // topHits of them and none overlapping a better one. Call it from
+    // outside the pool: it waits for the extensions it queues there.
+    std::vector<SeedHit> search(const DnaSequence& query) {
+        std::string bases[2] = {query.str(), ""};
+        bases[1] = reverseComplement(bases[0]);
+        const DnaSequence strands[2] = {query, DnaSequence(bases[1])};
+        const char strandNames[2] = {'+', '-'};
+
+        std::vector<std::future<SeedHit> > running;
+        for (int s = 0; s < 2; ++s) {
+            for (const SeedChain& found : chain(bases[s])) {
+                const DnaSequence* strandQuery = &strands[s];
+                char strand = strandNames[s];
+                running.push_back(pool.submit([this, strandQuery, strand, found] {
+                    return extend(*aligners[pool.workerIndex()], *strandQuery, strand, found);
+                }));
+            }
+        }
+
+        std::vector<SeedHit> hits;
+        std::exception_ptr error;
+        for (auto& task : running) {
+            try {
+                SeedHit hit = task.get();
+                if (hit.summary.score > 0) hits.push_back(std::move(hit));
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+        }
+        if (error) std::rethrow_exception(error);
+
+        // Chains are in seed order, so equal scores keep the better-seeded hit
+        std::stable_sort(hits.begin(), hits.end(), [](const SeedHit& a, const SeedHit& b) {
+            return a.summary.score > b.summary.score;
+        });
+        std::vector<SeedHit> best;
+        for (SeedHit& hit : hits) {
+            if (best.size() == options.topHits) break;
+            bool duplicate = std::any_of(best.begin(), best.end(),
+                                         [&hit](const SeedHit& kept) { return overlaps(kept, hit); });
+            if (!duplicate) best.push_back(std::move(hit));
+        }
+        return best;
+    }
+};
+
+#endif
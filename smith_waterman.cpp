@@ -1,209 +1,381 @@
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <string>
 #include <algorithm>
 #include <memory>
+#include <fstream>
+#include <deque>
+#include <future>
+#include <unordered_map>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include "fasta_reader.hpp"
+#include "dna_sequence.hpp"
+#include "smith_waterman.hpp"
+#include "edit_distance.hpp"
+#include "seed_search.hpp"
+#include "thread_pool.hpp"
 
-// Scoring constants
-const int MATCH_SCORE = 1;
-const int MISMATCH_SCORE = -1;
-const int GAP_SCORE = -2;
-
-// Structure to store cell information for traceback
-struct Cell {
-    int score;
-    int i;
-    int j;
-    char direction;  // 'D': diagonal, 'U': up, 'L': left
-
-    // Constructor for easier initialization
-    Cell(int s = 0, int ii = 0, int jj = 0, char d = '0') 
-        : score(s), i(ii), j(jj), direction(d) {}
+// One named sequence of a batch input file
+struct BatchSequence {
+    std::string name;
+    DnaSequence sequence;
 };
 
-class SmithWaterman {
-private:
-    std::string seq1, seq2;
-    std::vector<std::vector<Cell> > matrix;  // Fixed syntax here
-    std::string aligned1, aligned2;
-    int maxScore;
-    Cell maxCell;
-
-    // Read FASTA format file
-    std::string readFasta(const std::string& filename) {
-        std::ifstream file(filename);
-        if (!file.is_open()) {
-            throw std::runtime_error("Cannot open file: " + filename);
-        }
+// Every record with sequence data, in file order, 2-bit packed
+std::vector<BatchSequence> readBatchSequences(const std::string& filename) {
+    std::vector<BatchSequence> sequences;
+    FastaReader reader(filename);
+    FastaRecord record;
+    while (reader.next(record)) {
+        if (record.empty()) continue;
+        BatchSequence entry;
+        entry.name = std::string(record.name());
+        entry.sequence.appendRecord(record);
+        sequences.push_back(std::move(entry));
+    }
+    return sequences;
+}
 
-        std::string sequence, line;
-        bool firstLine = true;
-        
-        while (std::getline(file, line)) {
-            if (line.empty()) continue;
-            if (line[0] == '>') {
-                if (firstLine) {
-                    firstLine = false;
-                    continue;
-                }
-                break;
+// (query, target) index pairs to align: every combination, or the pairs of
+// names listed one per line in pairFile ('#' starts a comment line)
+std::vector<std::pair<size_t, size_t> > batchPairs(const std::vector<BatchSequence>& queries,
+                                                   const std::vector<BatchSequence>& targets,
+                                                   const std::string& pairFile) {
+    std::vector<std::pair<size_t, size_t> > pairs;
+    if (pairFile.empty()) {
+        pairs.reserve(queries.size() * targets.size());
+        for (size_t q = 0; q < queries.size(); ++q) {
+            for (size_t t = 0; t < targets.size(); ++t) {
+                pairs.emplace_back(q, t);
             }
-            sequence += line;
         }
-        
-        return sequence;
+        return pairs;
     }
 
-    // Initialize scoring matrix
-    void initializeMatrix() {
-        matrix.resize(seq1.length() + 1, std::vector<Cell>(seq2.length() + 1));
-        
-        // Initialize first row and column with zeros
-        for (size_t i = 0; i <= seq1.length(); ++i) {
-            matrix[i][0] = Cell();  // Fixed initialization
-        }
-        for (size_t j = 0; j <= seq2.length(); ++j) {
-            matrix[0][j] = Cell();  // Fixed initialization
+    auto indexByName = [](const std::vector<BatchSequence>& sequences) {
+        std::unordered_map<std::string, size_t> index;
+        for (size_t k = 0; k < sequences.size(); ++k) {
+            index.emplace(sequences[k].name, k);  // first record wins on duplicate names
         }
-    }
+        return index;
+    };
+    std::unordered_map<std::string, size_t> queryIndex = indexByName(queries);
+    std::unordered_map<std::string, size_t> targetIndex = indexByName(targets);
 
-    // Fill the scoring matrix
-    void fillMatrix() {
-        maxScore = 0;
-        
-        for (size_t i = 1; i <= seq1.length(); ++i) {
-            for (size_t j = 1; j <= seq2.length(); ++j) {
-                // Calculate match/mismatch score
-                int match = matrix[i-1][j-1].score + 
-                    (seq1[i-1] == seq2[j-1] ? MATCH_SCORE : MISMATCH_SCORE);
-                
-                // Calculate gap scores
-                int del = matrix[i-1][j].score + GAP_SCORE;
-                int ins = matrix[i][j-1].score + GAP_SCORE;
-                
-                // Find maximum score
-                int maxLocal = std::max(0, std::max(match, std::max(del, ins)));  // Fixed max syntax
-                
-                // Store the maximum score and its direction
-                if (maxLocal == 0) {
-                    matrix[i][j] = Cell(0, i, j, '0');  // Fixed initialization
-                } else if (maxLocal == match) {
-                    matrix[i][j] = Cell(maxLocal, i, j, 'D');  // Fixed initialization
-                } else if (maxLocal == del) {
-                    matrix[i][j] = Cell(maxLocal, i, j, 'U');  // Fixed initialization
-                } else {
-                    matrix[i][j] = Cell(maxLocal, i, j, 'L');  // Fixed initialization
-                }
-                
-                // Update maximum score if necessary
-                if (matrix[i][j].score > maxScore) {
-                    maxScore = matrix[i][j].score;
-                    maxCell = matrix[i][j];
-                    maxCell.i = i;
-                    maxCell.j = j;
-                }
-            }
+    std::ifstream in(pairFile);
+    if (!in) {
+        throw std::runtime_error("Cannot open file: " + pairFile);
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string query, target;
+        if (!(fields >> query) || query[0] == '#') continue;
+        if (!(fields >> target)) {
+            throw std::runtime_error("Expected a query and a target name in " + pairFile + ": " + line);
+        }
+        auto q = queryIndex.find(query);
+        auto t = targetIndex.find(target);
+        if (q == queryIndex.end() || t == targetIndex.end()) {
+            throw std::runtime_error("Unknown sequence name in " + pairFile + ": " + line);
         }
+        pairs.emplace_back(q->second, t->second);
     }
+    return pairs;
+}
 
-    // Perform traceback to find alignment
-    void traceback() {
-        aligned1.clear();
-        aligned2.clear();
-        
-        int i = maxCell.i;
-        int j = maxCell.j;
-        
-        while (i > 0 && j > 0 && matrix[i][j].score > 0) {
-            char direction = matrix[i][j].direction;
-            
-            if (direction == 'D') {
-                aligned1 = seq1[i-1] + aligned1;
-                aligned2 = seq2[j-1] + aligned2;
-                i--; j--;
-            } else if (direction == 'U') {
-                aligned1 = seq1[i-1] + aligned1;
-                aligned2 = '-' + aligned2;
-                i--;
-            } else if (direction == 'L') {
-                aligned1 = '-' + aligned1;
-                aligned2 = seq2[j-1] + aligned2;
-                j--;
-            }
-        }
+// Edit-distance options of a batch: a prefilter in front of the DP, or
+// edit distances instead of alignments
+struct EditOptions {
+    int maxEdits = -1;         // prefilter: align only pairs whose query occurs in the target within this many edits
+    bool distanceOnly = false; // report edit distances, no alignment
+    EditMode mode = EditMode::Infix;
+};
+
+// Outcome of one batch pair
+struct BatchResult {
+    bool aligned = false;  // false when the prefilter rejected the pair
+    AlignmentSummary summary;
+    Cigar cigar;
+    EditHit edits;
+};
+
+// Align many pairs on a work-stealing thread pool. Each worker keeps its own
+// SmithWaterman, so DP buffers are reused from one pair to the next. Results
+// are written as TSV, one row per pair in pair order, as soon as they and
+// every earlier pair are done. With a prefilter, Myers' bit-vector search
+// runs first and pairs above the edit threshold are left out.
+void runBatch(const std::string& queryFile, const std::string& targetFile, const std::string& pairFile,
+              size_t threads, const ScoringScheme& scoring, bool striped, const EditOptions& editOptions,
+              std::ostream& out) {
+    std::vector<BatchSequence> queries = readBatchSequences(queryFile);
+    std::vector<BatchSequence> targets = readBatchSequences(targetFile);
+    std::vector<std::pair<size_t, size_t> > pairs = batchPairs(queries, targets, pairFile);
+
+    ThreadPool pool(threads);
+    std::vector<std::unique_ptr<SmithWaterman> > aligners;
+    std::vector<std::string> texts(pool.size());  // per-worker unpacked target
+    for (size_t k = 0; k < pool.size(); ++k) {
+        aligners.push_back(std::make_unique<SmithWaterman>());
+        aligners.back()->setScoring(scoring);
+        aligners.back()->setStriped(striped);
     }
 
-public:
-    // Constructor
-    SmithWaterman(const std::string& file1, const std::string& file2) {
-        seq1 = readFasta(file1);
-        seq2 = readFasta(file2);
+    // Bit-vector patterns of the queries, built once and shared by all workers
+    bool useEdits = editOptions.distanceOnly || editOptions.maxEdits >= 0;
+    std::vector<MyersMatcher> matchers(useEdits ? queries.size() : 0);
+    for (size_t q = 0; q < matchers.size(); ++q) {
+        matchers[q].setPattern(queries[q].sequence.str());
     }
 
-    // Perform alignment
-    void align() {
-        initializeMatrix();
-        fillMatrix();
-        traceback();
+    if (editOptions.distanceOnly) {
+        out << "query\ttarget\tedit_distance\ttarget_end\n";
+    } else {
+        out << "query\ttarget\tscore\tquery_start\tquery_end\ttarget_start\ttarget_end"
+            << "\tlength\tmatches\tmismatches\tgaps\tgap_opens\tidentity\tcigar\n";
     }
+    out << std::fixed << std::setprecision(2);
 
-    // Generate match line
-    std::string generateMatchLine() const {
-        std::string matchLine;
-        for (size_t i = 0; i < aligned1.length(); ++i) {
-            if (aligned1[i] == aligned2[i] && aligned1[i] != '-') {
-                matchLine += '|';
-            } else if (aligned1[i] == '-' || aligned2[i] == '-') {
-                matchLine += ' ';
-            } else {
-                matchLine += ' ';
+    std::deque<std::future<BatchResult> > pending;
+    const size_t maxInFlight = pool.size() * 16;
+    size_t written = 0, aligned = 0;
+
+    auto writeFront = [&]() {
+        BatchResult result = pending.front().get();
+        pending.pop_front();
+        const std::pair<size_t, size_t>& pair = pairs[written++];
+        if (editOptions.distanceOnly) {
+            // -1: more edits than --max-edits allows
+            out << queries[pair.first].name << '\t' << targets[pair.second].name << '\t'
+                << (result.edits.found ? result.edits.distance : -1) << '\t' << result.edits.end << '\n';
+            return;
+        }
+        if (!result.aligned) return;
+        ++aligned;
+        const AlignmentSummary& summary = result.summary;
+        out << queries[pair.first].name << '\t' << targets[pair.second].name << '\t'
+            << summary.score << '\t' << summary.start1 << '\t' << summary.end1 << '\t'
+            << summary.start2 << '\t' << summary.end2 << '\t' << summary.length << '\t'
+            << summary.matches << '\t' << summary.mismatches << '\t' << summary.gaps << '\t'
+            << summary.gapOpens << '\t' << summary.identity() << '\t' << result.cigar.str() << '\n';
+    };
+
+    for (const std::pair<size_t, size_t>& pair : pairs) {
+        const DnaSequence& query = queries[pair.first].sequence;
+        const DnaSequence& target = targets[pair.second].sequence;
+        const MyersMatcher* matcher = useEdits ? &matchers[pair.first] : nullptr;
+        pending.push_back(pool.submit([&pool, &aligners, &texts, &editOptions, &query, &target, matcher] {
+            size_t worker = pool.workerIndex();
+            BatchResult result;
+            if (matcher != nullptr) {
+                target.decode(0, target.length(), texts[worker]);
+                result.edits = matcher->search(texts[worker], editOptions.mode, editOptions.maxEdits);
+                if (editOptions.distanceOnly || !result.edits.found) return result;
             }
+            SmithWaterman& sw = *aligners[worker];
+            sw.setSequences(query, target);
+            sw.align();
+            result.summary = sw.summary();
+            result.cigar = sw.cigar();
+            result.aligned = true;
+            return result;
+        }));
+
+        // Bound the reorder window so memory stays flat for huge pair lists
+        while (pending.size() > maxInFlight) {
+            writeFront();
         }
-        return matchLine;
     }
+    while (!pending.empty()) {
+        writeFront();
+    }
+    out.flush();
 
-    // Print alignment results
-    void printResults() const {
-        // Print sequences information
-        std::cout << "Sequence 1 length: " << seq1.length() << std::endl;
-        std::cout << "Sequence 2 length: " << seq2.length() << std::endl;
-        std::cout << "Alignment score: " << maxScore << std::endl << std::endl;
-
-        // Print alignment
-        const int LINE_LENGTH = 200;  // Characters per line
-        for (size_t i = 0; i < aligned1.length(); i += LINE_LENGTH) {
-            std::cout << aligned1.substr(i, LINE_LENGTH) << std::endl;
-            std::cout << generateMatchLine().substr(i, LINE_LENGTH) << std::endl;
-            std::cout << aligned2.substr(i, LINE_LENGTH) << std::endl << std::endl;
-        }
+    if (editOptions.maxEdits >= 0 && !editOptions.distanceOnly) {
+        std::cerr << "Prefilter: aligned " << aligned << " of " << pairs.size() << " pairs within "
+                  << editOptions.maxEdits << " edits" << std::endl;
+    }
+}
 
-        // Print alignment statistics
-        int matches = 0, mismatches = 0, gaps = 0;
-        for (size_t i = 0; i < aligned1.length(); ++i) {
-            if (aligned1[i] == aligned2[i]) matches++;
-            else if (aligned1[i] == '-' || aligned2[i] == '-') gaps++;
-            else mismatches++;
-        }
+// Seed-and-extend search of every query record against every target record
+// (see seed_search.hpp). TSV with the best hits of each query, best first;
+// on the '-' strand query positions and CIGAR are on the reverse complement.
+void runSearch(const std::string& queryFile, const std::string& targetFile, size_t threads,
+               const ScoringScheme& scoring, bool striped, const SeedOptions& seedOptions, std::ostream& out) {
+    std::vector<BatchSequence> queries = readBatchSequences(queryFile);
+    std::vector<BatchSequence> targetRecords = readBatchSequences(targetFile);
+    std::vector<DnaSequence> targets;
+    targets.reserve(targetRecords.size());
+    for (BatchSequence& record : targetRecords) targets.push_back(std::move(record.sequence));
 
-        std::cout << "Alignment Statistics:" << std::endl;
-        std::cout << "Matches: " << matches << std::endl;
-        std::cout << "Mismatches: " << mismatches << std::endl;
-        std::cout << "Gaps: " << gaps << std::endl;
-        std::cout << "Alignment length: " << aligned1.length() << std::endl;
-        float identity = (float)matches / aligned1.length() * 100;
-        std::cout << "Sequence identity: " << identity << "%" << std::endl;
+    ThreadPool pool(threads);
+    SeedIndex index;
+    index.build(targets, seedOptions.k, seedOptions.w, pool);
+    std::cerr << "Index: " << index.size() << " minimizers (k = " << seedOptions.k << ", w = " << seedOptions.w
+              << ", " << (index.memoryUsage() >> 20) << " MiB) over " << targets.size() << " records" << std::endl;
+
+    SeedSearch search(targets, index, seedOptions, scoring, pool);
+    search.setStriped(striped);
+
+    out << "query\ttarget\tstrand\tscore\tquery_start\tquery_end\ttarget_start\ttarget_end"
+        << "\tlength\tmatches\tmismatches\tgaps\tgap_opens\tidentity\tseeds\tcigar\n";
+    out << std::fixed << std::setprecision(2);
+    for (const BatchSequence& query : queries) {
+        for (const SeedHit& hit : search.search(query.sequence)) {
+            const AlignmentSummary& summary = hit.summary;
+            out << query.name << '\t' << targetRecords[hit.target].name << '\t' << hit.strand << '\t'
+                << summary.score << '\t' << summary.start1 << '\t' << summary.end1 << '\t'
+                << summary.start2 << '\t' << summary.end2 << '\t' << summary.length << '\t'
+                << summary.matches << '\t' << summary.mismatches << '\t' << summary.gaps << '\t'
+                << summary.gapOpens << '\t' << summary.identity() << '\t' << hit.seeds << '\t'
+                << hit.cigar.str() << '\n';
+        }
     }
-};
+    out.flush();
+}
 
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <sequence1.fna> <sequence2.fna>" << std::endl;
+    std::vector<std::string> files;
+    bool striped = true;
+    bool batch = false;
+    bool search = false;
+    SeedOptions seedOptions;
+    std::string pairFile, outputFile;
+    std::string region1, region2;
+    size_t threads = 0;
+    ScoringScheme scoring;
+    EditOptions editOptions;
+    bool usage = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (parseScoringOption(argc, argv, i, scoring)) {
+            continue;
+        } else if (arg == "--scalar") {
+            striped = false;
+        } else if (arg == "--batch") {
+            batch = true;
+        } else if (arg == "--search") {
+            search = true;
+        } else if (arg == "-k" && i + 1 < argc) {
+            seedOptions.k = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "-w" && i + 1 < argc) {
+            seedOptions.w = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--top" && i + 1 < argc) {
+            seedOptions.topHits = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--max-occurrences" && i + 1 < argc) {
+            seedOptions.maxOccurrences = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--min-seeds" && i + 1 < argc) {
+            seedOptions.minSeeds = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--pairs" && i + 1 < argc) {
+            pairFile = argv[++i];
+        } else if ((arg == "-o" || arg == "--output") && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else if ((arg == "-t" || arg == "--threads") && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);  // 0 = all cores
+        } else if (arg == "--region1" && i + 1 < argc) {
+            region1 = argv[++i];
+        } else if (arg == "--region2" && i + 1 < argc) {
+            region2 = argv[++i];
+        } else if (arg == "--max-edits" && i + 1 < argc) {
+            editOptions.maxEdits = std::atoi(argv[++i]);
+        } else if (arg == "--edit-distance" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            editOptions.distanceOnly = true;
+            editOptions.mode = mode == "global" ? EditMode::Global : EditMode::Infix;
+            usage |= mode != "global" && mode != "infix";
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    if (usage || files.size() != 2) {
+        std::cerr << "Usage: " << argv[0] << " [--scalar] [--gap-open <cost>] [--gap-extend <cost>]"
+                  << " [--region1 <region>] [--region2 <region>] [--max-edits <k>] [--edit-distance <mode>]"
+                  << " <sequence1.fna> <sequence2.fna>" << std::endl;
+        std::cerr << "       " << argv[0] << " --batch [--pairs <pairs.txt>] [-t <threads>] [-o <out.tsv>]"
+                  << " [options] <queries.fna> <targets.fna>" << std::endl;
+        std::cerr << "       " << argv[0] << " --search [-k <k>] [-w <w>] [--top <n>] [--max-occurrences <n>]"
+                  << " [--min-seeds <n>] [-t <threads>] [-o <out.tsv>] [options] <queries.fna> <genome.fna>" << std::endl;
+        std::cerr << "  --scalar   fill the whole matrix instead of using the striped SIMD kernel ("
+                  << stripedKernelName(bestStripedKernel()) << ")" << std::endl;
+        std::cerr << "  --batch    align every query record against every target record and write TSV"
+                  << " (positions, counts and the CIGAR, query as sequence 1)" << std::endl;
+        std::cerr << "  --search   seed-and-extend: find the best local hits of every query on both strands of"
+                  << " large targets, running the DP only in windows around chains of shared minimizers" << std::endl;
+        std::cerr << "  -k K, -w W        seed k-mer length (1-31, default " << SeedOptions().k << ") and minimizer"
+                  << " window in k-mers (default " << SeedOptions().w << ", 1 = every k-mer)" << std::endl;
+        std::cerr << "  --top N           hits reported per query (default " << SeedOptions().topHits << ")" << std::endl;
+        std::cerr << "  --max-occurrences N   skip minimizers seen more than N times in the targets (default "
+                  << SeedOptions().maxOccurrences << "); --min-seeds N: seeds a chain needs (default "
+                  << SeedOptions().minSeeds << ")" << std::endl;
+        std::cerr << "  --pairs    only align the listed \"query target\" name pairs, one per line" << std::endl;
+        std::cerr << "  -t, --threads N   batch or search worker threads, or threads filling one large alignment (0 = all cores)" << std::endl;
+        std::cerr << "  -o, --output F    write the batch or search TSV to F instead of stdout" << std::endl;
+        std::cerr << "  --region1 R, --region2 R   align a record or part of one (\"chr:start-end\", 1-based)"
+                  << " instead of the first record, through the file's .fai index" << std::endl;
+        std::cerr << "  --max-edits K     prefilter: only align when sequence1 (the query) occurs in sequence2"
+                  << " with at most K edits, found by Myers' bit-vector search" << std::endl;
+        std::cerr << "  --edit-distance infix|global   report the edit distance (query within the target, or"
+                  << " whole against whole) and where it ends instead of aligning; -1 above --max-edits" << std::endl;
+        std::cerr << "Gaps of length k cost gap-open + (k - 1) * gap-extend (default 2 and 2)." << std::endl;
         return 1;
     }
 
     try {
-        SmithWaterman sw(argv[1], argv[2]);
+        if (search) {
+            scoring.validate();
+            seedOptions.validate();
+            if (outputFile.empty()) {
+                std::ios::sync_with_stdio(false);
+                runSearch(files[0], files[1], threads, scoring, striped, seedOptions, std::cout);
+            } else {
+                std::ofstream out(outputFile);
+                if (!out) {
+                    throw std::runtime_error("Cannot open file: " + outputFile);
+                }
+                runSearch(files[0], files[1], threads, scoring, striped, seedOptions, out);
+            }
+            return 0;
+        }
+        if (batch) {
+            scoring.validate();
+            if (outputFile.empty()) {
+                std::ios::sync_with_stdio(false);
+                runBatch(files[0], files[1], pairFile, threads, scoring, striped, editOptions, std::cout);
+            } else {
+                std::ofstream out(outputFile);
+                if (!out) {
+                    throw std::runtime_error("Cannot open file: " + outputFile);
+                }
+                runBatch(files[0], files[1], pairFile, threads, scoring, striped, editOptions, out);
+            }
+            return 0;
+        }
+
+        DnaSequence seq1 = readDnaSequence(files[0], region1);
+        DnaSequence seq2 = readDnaSequence(files[1], region2);
+        if (editOptions.distanceOnly || editOptions.maxEdits >= 0) {
+            EditHit hit = MyersMatcher(seq1.str()).search(seq2.str(), editOptions.mode, editOptions.maxEdits);
+            if (editOptions.distanceOnly) {
+                std::cout << "Edit distance: " << (hit.found ? hit.distance : -1)
+                          << " (ends at position " << hit.end << " of sequence2)" << std::endl;
+                return 0;
+            }
+            if (!hit.found) {
+                std::cout << "No alignment: sequence1 is not within " << editOptions.maxEdits
+                          << " edits of sequence2" << std::endl;
+                return 0;
+            }
+        }
+
+        SmithWaterman sw;
+        sw.setSequences(seq1, seq2);
+        sw.setStriped(striped);
+        sw.setThreads(threads);
+        sw.setScoring(scoring);
         sw.align();
         sw.printResults();
     } catch (const std::exception& e) {
@@ -0,0 +1,308 @@
+#ifndef SMITH_WATERMAN_HPP
+#define SMITH_WATERMAN_HPP
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include "dna_sequence.hpp"
+#include "alignment_scoring.hpp"
+#include "alignment_cigar.hpp"
+#include "alignment_wavefront.hpp"
+#include "smith_waterman_striped.hpp"
+
+// Where the local alignment lies and what it is made of (the column counts,
+// taken from the traceback). Coordinates are 1-based and inclusive; all zero
+// when nothing aligns.
+struct AlignmentSummary : AlignmentStats {
+    int score = 0;
+    size_t start1 = 0, end1 = 0;  // in seq1
+    size_t start2 = 0, end2 = 0;  // in seq2
+};
+
+class SmithWaterman {
+private:
+    DnaSequence seq1, seq2;                  // 2-bit packed
+    std::string columns;                     // seq2 over the block's columns, unpacked for the fill
+    std::string rowBases;                    // seq1 over the block's rows, unpacked for the fill
+    TracebackMatrix matrix;                  // Traceback block, see rowOffset/colOffset
+    Cigar path;                              // from startI/startJ to the best cell
+    ScoringScheme scoring;
+    int maxScore;
+    size_t maxI = 0, maxJ = 0;              // Best cell, in block coordinates
+    size_t rowOffset = 0, colOffset = 0;    // matrix(0, 0) is cell (rowOffset, colOffset)
+    size_t startI = 0, startJ = 0;          // Cell before the first aligned pair, in sequence coordinates
+    bool useStriped = true;
+    std::unique_ptr<ThreadPool> fillPool;   // wavefront fill of large blocks, see setThreads
+    PhaseTimings timings;
+
+    // Read the first record of a FASTA file
+    DnaSequence readFasta(const std::string& filename) {
+        return readFirstDnaSequence(filename);
+    }
+
+    // Initialize the traceback matrix for the block of rows x cols cells after the offsets
+    void initializeMatrix(size_t rows, size_t cols) {
+        matrix.reset(rows, cols);
+        seq2.decode(colOffset, cols, columns);
+    }
+
+    // Fill the traceback matrix (Gotoh). Scores and the gap states E (up)
+    // and F (left) only live in a rolling row and column; cells keep their
+    // direction and flags. Large blocks are filled as a tiled wavefront on
+    // fillPool.
+    void fillMatrix() {
+        size_t rows = matrix.rows(), cols = matrix.cols();
+        seq1.decode(rowOffset, rows, rowBases);
+        GotohEdges edges;
+        edges.h.assign(cols + 1, 0);
+        edges.e.assign(cols + 1, NEG_INF);
+        edges.hLeft.assign(rows + 1, 0);
+        edges.f.assign(rows + 1, NEG_INF);
+        edges.corner.assign(rows + 1, 0);
+
+        bool parallel = fillPool && rows * cols >= WAVEFRONT_MIN_CELLS;
+        LocalBest best;
+        std::mutex bestMutex;
+        runWavefront(parallel ? fillPool.get() : nullptr, rows, cols,
+                     parallel ? WAVEFRONT_TILE : std::max(rows, cols),
+                     [&](size_t i0, size_t i1, size_t j0, size_t j1) {
+            LocalBest tileBest = fillGotohTile<true>(matrix, rowBases, columns, scoring, edges, i0, i1, j0, j1);
+            std::lock_guard<std::mutex> lock(bestMutex);
+            best.merge(tileBest);
+        });
+        maxScore = best.score;
+        maxI = best.i;
+        maxJ = best.j;
+    }
+
+    // Top-left corner of a block that holds the traceback path of the hit.
+    // Scores a DP anchored at the hit and running backwards; a path start x
+    // has score == hit.score, and every cell between x and the hit keeps a
+    // non-negative score, so cells that drop below zero are pruned and the
+    // search stays near the alignment. The block spans every such start, so
+    // it contains the path the full-matrix traceback would take.
+    // Running backwards charges a gap that straddles a cell one extra
+    // gapOpen - gapExtend, so the gap states are pruned that much lower.
+    void findBlockStart(const StripedHit& hit, size_t& blockI, size_t& blockJ) const {
+        const int threshold = -(scoring.gapOpen - scoring.gapExtend);
+        auto prune = [threshold](int score) { return score < threshold ? NEG_INF : score; };
+
+        // H and E of the previous and current rows, NEG_INF = pruned
+        std::vector<int> prevH(hit.endJ + 1, NEG_INF), prevE(hit.endJ + 1, NEG_INF);
+        std::vector<int> curH(hit.endJ + 1), curE(hit.endJ + 1);
+        size_t lo = 0, hi = 0;  // live columns of the previous row
+        size_t maxP = 0, maxQ = 0;
+        std::string prefix2;
+        seq2.decode(0, hit.endJ, prefix2);
+
+        for (size_t p = 0; p <= hit.endI; ++p) {
+            char base1 = p > 0 ? seq1[hit.endI - p] : '\0';
+            bool live = false;
+            size_t rowLo = 0, rowHi = 0;
+            int left = NEG_INF, f = NEG_INF;
+            for (size_t q = lo; q <= hit.endJ; ++q) {
+                bool above = q <= hi;
+                if (!above && q > hi + 1 && left == NEG_INF && f == NEG_INF) break;
+
+                int h = p == 0 && q == 0 ? 0 : NEG_INF;
+                int e = above ? prune(std::max(prevH[q] - scoring.gapOpen, prevE[q] - scoring.gapExtend))
+                              : NEG_INF;
+                if (q > lo) f = prune(std::max(left - scoring.gapOpen, f - scoring.gapExtend));
+                if (p > 0 && q > lo && q - 1 <= hi && prevH[q-1] != NEG_INF) {
+                    h = prevH[q-1] + scoring.substitution(base1, prefix2[hit.endJ - q]);
+                }
+                h = prune(std::max(h, std::max(e, f)));
+                curH[q] = left = h;
+                curE[q] = e;
+
+                if (h != NEG_INF || e != NEG_INF) {
+                    if (!live) rowLo = q;
+                    live = true;
+                    rowHi = q;
+                }
+                if (h == hit.score) {
+                    maxP = std::max(maxP, p);
+                    maxQ = std::max(maxQ, q);
+                }
+            }
+            if (!live) break;
+            prevH.swap(curH);
+            prevE.swap(curE);
+            lo = rowLo;
+            hi = rowHi;
+        }
+        blockI = hit.endI - maxP;
+        blockJ = hit.endJ - maxQ;
+    }
+
+    // Fill and trace back the rows x cols block after the offsets
+    void fillAndTrace(size_t rows, size_t cols) {
+        PhaseClock::time_point start = PhaseClock::now();
+        initializeMatrix(rows, cols);
+        fillMatrix();
+        timings.fill = secondsSince(start);
+        timings.fillCells = rows * cols;
+
+        start = PhaseClock::now();
+        traceback();
+        timings.traceback = secondsSince(start);
+    }
+
+    // Trace back from the best cell; the path is pushed end to start and
+    // reversed once
+    void traceback() {
+        path.clear();
+
+        size_t i = maxI;
+        size_t j = maxJ;
+        char state = 'H';  // 'U' / 'L' while inside a gap run
+
+        while (i > 0 && j > 0) {
+            Cell cell = matrix(i, j);
+            if (state == 'H') {
+                if (cell.direction == '0') break;
+                if (cell.direction == 'D') {
+                    path.push(rowBases[i - 1] == columns[j - 1] ? '=' : 'X');
+                    i--; j--;
+                    continue;
+                }
+                state = cell.direction;
+            }
+
+            if (state == 'U') {
+                path.push('I');
+                state = (cell.flags & EXTEND_UP) ? 'U' : 'H';
+                i--;
+            } else {
+                path.push('D');
+                state = (cell.flags & EXTEND_LEFT) ? 'L' : 'H';
+                j--;
+            }
+        }
+        path.reverse();
+        startI = rowOffset + i;
+        startJ = colOffset + j;
+    }
+
+public:
+    // Aligner without sequences, for reuse across many pairs via setSequences
+    SmithWaterman() = default;
+
+    // Constructor
+    SmithWaterman(const std::string& file1, const std::string& file2) {
+        seq1 = readFasta(file1);
+        seq2 = readFasta(file2);
+    }
+
+    // Replace the sequences; the DP matrix storage is kept for the next align()
+    void setSequences(const DnaSequence& first, const DnaSequence& second) {
+        seq1 = first;
+        seq2 = second;
+    }
+
+    // Use the scalar full-matrix fill instead of the striped SIMD kernel
+    void setStriped(bool enabled) { useStriped = enabled; }
+
+    // Threads for filling large traceback blocks (0 = all cores, 1 = the
+    // calling thread only); the alignment is the same for any count
+    void setThreads(size_t threads) {
+        if (threads == 0) threads = ThreadPool::defaultThreadCount();
+        fillPool = threads > 1 ? std::make_unique<ThreadPool>(threads) : nullptr;
+    }
+
+    void setScoring(const ScoringScheme& newScoring) {
+        newScoring.validate();
+        scoring = newScoring;
+    }
+
+    // Perform alignment
+    void align() {
+        timings = PhaseTimings();
+        rowOffset = colOffset = 0;
+        if (!useStriped) {
+            fillAndTrace(seq1.length(), seq2.length());
+            return;
+        }
+
+        // Score and end cell from the striped kernel, then fill and trace
+        // back only the block around the hit
+        PhaseClock::time_point start = PhaseClock::now();
+        StripedHit hit = stripedLocalAlignment(seq1.str(), seq2.str(), scoring);
+        if (hit.score == 0) {
+            matrix.reset(0, 0);
+            maxScore = 0;
+            maxI = maxJ = 0;
+            traceback();
+            timings.scan = secondsSince(start);
+            return;
+        }
+        findBlockStart(hit, rowOffset, colOffset);
+        timings.scan = secondsSince(start);
+        fillAndTrace(hit.endI - rowOffset, hit.endJ - colOffset);
+    }
+
+    // Time spent in each phase of the last align()
+    const PhaseTimings& phaseTimings() const { return timings; }
+
+    AlignmentSummary summary() const {
+        AlignmentSummary result;
+        result.score = maxScore;
+        if (path.empty()) return result;
+        static_cast<AlignmentStats&>(result) = path.stats();
+        result.start1 = startI + 1;
+        result.end1 = rowOffset + maxI;
+        result.start2 = startJ + 1;
+        result.end2 = colOffset + maxJ;
+        return result;
+    }
+
+    // Path of the last alignment, seq1 as the query
+    const Cigar& cigar() const { return path; }
+
+    // Gapped rows of the last alignment, built from the CIGAR
+    void alignedStrings(std::string& aligned1, std::string& aligned2) const {
+        path.render(seq1.substr(startI, path.span1()), seq2.substr(startJ, path.span2()), aligned1, aligned2);
+    }
+
+    // Generate match line
+    std::string generateMatchLine() const {
+        return path.matchLine();
+    }
+
+    // Print alignment results
+    void printResults() const {
+        // Print sequences information
+        std::cout << "Sequence 1 length: " << seq1.length() << std::endl;
+        std::cout << "Sequence 2 length: " << seq2.length() << std::endl;
+        std::cout << "Alignment score: " << maxScore << std::endl << std::endl;
+
+        // Print alignment
+        const int LINE_LENGTH = 200;  // Characters per line
+        std::string aligned1, aligned2;
+        alignedStrings(aligned1, aligned2);
+        Cigar::Cursor cursor;  // match line built per block
+        std::string block;
+        for (size_t i = 0; i < aligned1.length(); i += LINE_LENGTH) {
+            block.assign(aligned1, i, LINE_LENGTH) += '\n';
+            block += path.matchLine(cursor, LINE_LENGTH) + '\n';
+            block.append(aligned2, i, LINE_LENGTH) += "\n\n";
+            std::cout << block;
+        }
+
+        // Print alignment statistics, counted during the traceback
+        const AlignmentStats& stats = path.stats();
+        std::cout << "Alignment Statistics:\n";
+        std::cout << "Matches: " << stats.matches << "\n";
+        std::cout << "Mismatches: " << stats.mismatches << "\n";
+        std::cout << "Gaps: " << stats.gaps << "\n";
+        std::cout << "Gap opens: " << stats.gapOpens << "\n";
+        std::cout << "Alignment length: " << stats.length << "\n";
+        std::cout << "Sequence identity: " << stats.identity() << "%\n";
+        std::cout << "CIGAR: " << path.str() << std::endl;
+    }
+};
+
+#endif
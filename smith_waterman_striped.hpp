@@ -0,0 +1,471 @@
+#ifndef SMITH_WATERMAN_STRIPED_HPP
+#define SMITH_WATERMAN_STRIPED_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "alignment_scoring.hpp"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define STRIPED_SW_X86 1
+#include <immintrin.h>
+#endif
+
+// Farrar's striped Smith-Waterman score kernel. seq2 is the query: it is laid
+// out in a striped query profile so one vector covers positions j, j+segLen,
+// j+2*segLen, ... and the inner loop has no lane dependencies. seq1 streams
+// through the outer loop, so every outer iteration computes one matrix row.
+// Scores are first computed in saturating 8-bit lanes and re-run in 16-bit
+// lanes when they would overflow.
+
+// Best local alignment score and the cell it ends in, 1-based like the DP
+// matrix (i over seq1, j over seq2). The first cell in row-major order that
+// reaches the best score is reported, the same one a scalar fill keeps.
+struct StripedHit {
+    int score = 0;
+    size_t endI = 0;
+    size_t endJ = 0;
+};
+
+enum class StripedKernel { Scalar, SSE41, AVX2 };
+
+inline const char* stripedKernelName(StripedKernel kernel) {
+    switch (kernel) {
+        case StripedKernel::SSE41: return "sse4.1";
+        case StripedKernel::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+// seq1 translated to profile rows, one row per distinct character
+struct StripedQuery {
+    std::vector<uint8_t> rows;     // profile row of each seq1 character
+    std::vector<char> alphabet;    // character of each profile row
+};
+
+inline StripedQuery buildStripedQuery(const std::string& seq1) {
+    StripedQuery query;
+    int rowOf[256];
+    std::fill(rowOf, rowOf + 256, -1);
+    query.rows.resize(seq1.size());
+    for (size_t i = 0; i < seq1.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(seq1[i]);
+        if (rowOf[c] < 0) {
+            rowOf[c] = static_cast<int>(query.alphabet.size());
+            query.alphabet.push_back(seq1[i]);
+        }
+        query.rows[i] = static_cast<uint8_t>(rowOf[c]);
+    }
+    return query;
+}
+
+// Striped profile: for each alphabet row, segLen vectors of `lanes` scores.
+// Lane k of vector s holds the score against seq2[k * segLen + s]; positions
+// past the end of seq2 get padScore so they never win.
+template <typename T>
+std::vector<T> buildStripedProfile(const std::string& seq2, const StripedQuery& query,
+                                   const ScoringScheme& scoring, size_t lanes, int bias, int padScore) {
+    size_t m = seq2.size();
+    size_t segLen = (m + lanes - 1) / lanes;
+    std::vector<T> profile(query.alphabet.size() * segLen * lanes);
+    T* out = profile.data();
+    for (char c : query.alphabet) {
+        for (size_t s = 0; s < segLen; ++s) {
+            for (size_t k = 0; k < lanes; ++k) {
+                size_t j = k * segLen + s;
+                int score = j < m ? scoring.substitution(seq2[j], c) : padScore;
+                *out++ = static_cast<T>(score + bias);
+            }
+        }
+    }
+    return profile;
+}
+
+// Smallest j (1-based) whose striped row value equals score
+template <typename T>
+size_t stripedColumnOf(const std::vector<T>& row, size_t m, size_t lanes, int score) {
+    size_t segLen = (m + lanes - 1) / lanes;
+    for (size_t j = 0; j < m; ++j) {
+        if (static_cast<int>(row[(j % segLen) * lanes + j / segLen]) == score) return j + 1;
+    }
+    return 0;
+}
+
+// Two-row scalar fill with the same recurrences; used off x86 and when even
+// 16-bit lanes would overflow
+inline StripedHit scalarLocalHit(const std::string& seq1, const std::string& seq2,
+                                 const ScoringScheme& scoring) {
+    StripedHit hit;
+    size_t m = seq2.size();
+    std::vector<int> h(m + 1, 0), e(m + 1, 0);
+    for (size_t i = 1; i <= seq1.size(); ++i) {
+        int diagonal = 0, f = 0, left = 0;
+        for (size_t j = 1; j <= m; ++j) {
+            int up = h[j];
+            e[j] = std::max(e[j] - scoring.gapExtend, up - scoring.gapOpen);
+            f = std::max(f - scoring.gapExtend, left - scoring.gapOpen);
+            int match = diagonal + scoring.substitution(seq1[i-1], seq2[j-1]);
+            int score = std::max(0, std::max(match, std::max(e[j], f)));
+            diagonal = up;
+            h[j] = left = score;
+            if (score > hit.score) {
+                hit.score = score;
+                hit.endI = i;
+                hit.endJ = j;
+            }
+        }
+    }
+    return hit;
+}
+
+#ifdef STRIPED_SW_X86
+
+// Horizontal maxima
+__attribute__((target("sse4.1")))
+inline int maxEpu8SSE41(__m128i v) {
+    v = _mm_max_epu8(v, _mm_srli_si128(v, 8));
+    v = _mm_max_epu8(v, _mm_srli_si128(v, 4));
+    v = _mm_max_epu8(v, _mm_srli_si128(v, 2));
+    v = _mm_max_epu8(v, _mm_srli_si128(v, 1));
+    return _mm_extract_epi8(v, 0);
+}
+
+__attribute__((target("sse4.1")))
+inline int maxEpi16SSE41(__m128i v) {
+    v = _mm_max_epi16(v, _mm_srli_si128(v, 8));
+    v = _mm_max_epi16(v, _mm_srli_si128(v, 4));
+    v = _mm_max_epi16(v, _mm_srli_si128(v, 2));
+    return static_cast<int16_t>(_mm_extract_epi16(v, 0));
+}
+
+// Shift a whole 256-bit register up by one 8-bit / 16-bit lane
+__attribute__((target("avx2")))
+inline __m256i shiftLanes8AVX2(__m256i v) {
+    return _mm256_alignr_epi8(v, _mm256_permute2x128_si256(v, v, 0x08), 15);
+}
+
+__attribute__((target("avx2")))
+inline __m256i shiftLanes16AVX2(__m256i v) {
+    return _mm256_alignr_epi8(v, _mm256_permute2x128_si256(v, v, 0x08), 14);
+}
+
+// Each kernel returns false when its lanes may have saturated. The four
+// bodies are the same algorithm, spelled out per ISA and lane width:
+//   H = max(0, Hdiag + W, E, F)        E: gap along seq1 (carried row to row)
+//   E' = max(E - ext, H - open)        F: gap along seq2 (within the row,
+//   F' = max(F - ext, H - open)           finished by the lazy-F loop)
+
+__attribute__((target("sse4.1")))
+inline bool stripedByteSSE41(const StripedQuery& query, const std::string& seq2,
+                             const ScoringScheme& scoring, StripedHit& hit) {
+    const size_t LANES = 16;
+    size_t m = seq2.size();
+    size_t segLen = (m + LANES - 1) / LANES;
+    int bias = std::max(0, -std::min(scoring.match, scoring.mismatch));
+    std::vector<uint8_t> profile = buildStripedProfile<uint8_t>(seq2, query, scoring, LANES, bias, -bias);
+    std::vector<uint8_t> store(segLen * LANES), load(segLen * LANES), gapE(segLen * LANES), bestRow(segLen * LANES);
+    __m128i* pStore = reinterpret_cast<__m128i*>(store.data());
+    __m128i* pLoad = reinterpret_cast<__m128i*>(load.data());
+    __m128i* pE = reinterpret_cast<__m128i*>(gapE.data());
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i vBias = _mm_set1_epi8(static_cast<char>(bias));
+    const __m128i vOpen = _mm_set1_epi8(static_cast<char>(scoring.gapOpen));
+    const __m128i vExtend = _mm_set1_epi8(static_cast<char>(scoring.gapExtend));
+    const int limit = 255 - bias;
+
+    for (size_t i = 0; i < query.rows.size(); ++i) {
+        const __m128i* prof = reinterpret_cast<const __m128i*>(profile.data() + query.rows[i] * segLen * LANES);
+        __m128i vF = zero, vMax = zero;
+        __m128i vH = _mm_slli_si128(_mm_loadu_si128(pStore + segLen - 1), 1);
+        std::swap(pStore, pLoad);
+
+        for (size_t s = 0; s < segLen; ++s) {
+            vH = _mm_subs_epu8(_mm_adds_epu8(vH, _mm_loadu_si128(prof + s)), vBias);
+            __m128i vE = _mm_loadu_si128(pE + s);
+            vH = _mm_max_epu8(_mm_max_epu8(vH, vE), vF);
+            vMax = _mm_max_epu8(vMax, vH);
+            _mm_storeu_si128(pStore + s, vH);
+            __m128i vHOpen = _mm_subs_epu8(vH, vOpen);
+            _mm_storeu_si128(pE + s, _mm_max_epu8(_mm_subs_epu8(vE, vExtend), vHOpen));
+            vF = _mm_max_epu8(_mm_subs_epu8(vF, vExtend), vHOpen);
+            vH = _mm_loadu_si128(pLoad + s);
+        }
+
+        // Lazy F: carry F across lane boundaries until it can no longer raise H
+        vF = _mm_slli_si128(vF, 1);
+        for (size_t s = 0;;) {
+            __m128i vHs = _mm_loadu_si128(pStore + s);
+            __m128i gain = _mm_subs_epu8(vF, _mm_subs_epu8(vHs, vOpen));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(gain, zero)) == 0xFFFF) break;
+            vHs = _mm_max_epu8(vHs, vF);
+            vMax = _mm_max_epu8(vMax, vHs);
+            _mm_storeu_si128(pStore + s, vHs);
+            _mm_storeu_si128(pE + s, _mm_max_epu8(_mm_loadu_si128(pE + s), _mm_subs_epu8(vHs, vOpen)));
+            vF = _mm_subs_epu8(vF, vExtend);
+            if (++s == segLen) {
+                s = 0;
+                vF = _mm_slli_si128(vF, 1);
+            }
+        }
+
+        int rowMax = maxEpu8SSE41(vMax);
+        if (rowMax >= limit) return false;
+        if (rowMax > hit.score) {
+            hit.score = rowMax;
+            hit.endI = i + 1;
+            std::memcpy(bestRow.data(), pStore, bestRow.size());
+        }
+    }
+    if (hit.score > 0) hit.endJ = stripedColumnOf(bestRow, m, LANES, hit.score);
+    return true;
+}
+
+__attribute__((target("sse4.1")))
+inline bool stripedWordSSE41(const StripedQuery& query, const std::string& seq2,
+                             const ScoringScheme& scoring, StripedHit& hit) {
+    const size_t LANES = 8;
+    size_t m = seq2.size();
+    size_t segLen = (m + LANES - 1) / LANES;
+    std::vector<int16_t> profile = buildStripedProfile<int16_t>(seq2, query, scoring, LANES, 0, -0x4000);
+    std::vector<int16_t> store(segLen * LANES), load(segLen * LANES), gapE(segLen * LANES), bestRow(segLen * LANES);
+    __m128i* pStore = reinterpret_cast<__m128i*>(store.data());
+    __m128i* pLoad = reinterpret_cast<__m128i*>(load.data());
+    __m128i* pE = reinterpret_cast<__m128i*>(gapE.data());
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i vOpen = _mm_set1_epi16(static_cast<short>(scoring.gapOpen));
+    const __m128i vExtend = _mm_set1_epi16(static_cast<short>(scoring.gapExtend));
+    const int limit = 0x7FFF - std::max(scoring.match, 0);
+
+    for (size_t i = 0; i < query.rows.size(); ++i) {
+        const __m128i* prof = reinterpret_cast<const __m128i*>(profile.data() + query.rows[i] * segLen * LANES);
+        __m128i vF = zero, vMax = zero;
+        __m128i vH = _mm_slli_si128(_mm_loadu_si128(pStore + segLen - 1), 2);
+        std::swap(pStore, pLoad);
+
+        for (size_t s = 0; s < segLen; ++s) {
+            vH = _mm_max_epi16(_mm_adds_epi16(vH, _mm_loadu_si128(prof + s)), zero);
+            __m128i vE = _mm_loadu_si128(pE + s);
+            vH = _mm_max_epi16(_mm_max_epi16(vH, vE), vF);
+            vMax = _mm_max_epi16(vMax, vH);
+            _mm_storeu_si128(pStore + s, vH);
+            __m128i vHOpen = _mm_subs_epi16(vH, vOpen);
+            _mm_storeu_si128(pE + s, _mm_max_epi16(_mm_subs_epi16(vE, vExtend), vHOpen));
+            vF = _mm_max_epi16(_mm_subs_epi16(vF, vExtend), vHOpen);
+            vH = _mm_loadu_si128(pLoad + s);
+        }
+
+        vF = _mm_slli_si128(vF, 2);
+        for (size_t s = 0;;) {
+            __m128i vHs = _mm_loadu_si128(pStore + s);
+            // An F <= 0 never raises H; comparing against zero as well keeps a
+            // zero gap-extend from cycling such lanes forever
+            if (_mm_movemask_epi8(_mm_cmpgt_epi16(vF, _mm_max_epi16(_mm_subs_epi16(vHs, vOpen), zero))) == 0) break;
+            vHs = _mm_max_epi16(vHs, vF);
+            vMax = _mm_max_epi16(vMax, vHs);
+            _mm_storeu_si128(pStore + s, vHs);
+            _mm_storeu_si128(pE + s, _mm_max_epi16(_mm_loadu_si128(pE + s), _mm_subs_epi16(vHs, vOpen)));
+            vF = _mm_subs_epi16(vF, vExtend);
+            if (++s == segLen) {
+                s = 0;
+                vF = _mm_slli_si128(vF, 2);
+            }
+        }
+
+        int rowMax = maxEpi16SSE41(vMax);
+        if (rowMax >= limit) return false;
+        if (rowMax > hit.score) {
+            hit.score = rowMax;
+            hit.endI = i + 1;
+            std::memcpy(bestRow.data(), pStore, bestRow.size() * sizeof(int16_t));
+        }
+    }
+    if (hit.score > 0) hit.endJ = stripedColumnOf(bestRow, m, LANES, hit.score);
+    return true;
+}
+
+__attribute__((target("avx2")))
+inline bool stripedByteAVX2(const StripedQuery& query, const std::string& seq2,
+                            const ScoringScheme& scoring, StripedHit& hit) {
+    const size_t LANES = 32;
+    size_t m = seq2.size();
+    size_t segLen = (m + LANES - 1) / LANES;
+    int bias = std::max(0, -std::min(scoring.match, scoring.mismatch));
+    std::vector<uint8_t> profile = buildStripedProfile<uint8_t>(seq2, query, scoring, LANES, bias, -bias);
+    std::vector<uint8_t> store(segLen * LANES), load(segLen * LANES), gapE(segLen * LANES), bestRow(segLen * LANES);
+    __m256i* pStore = reinterpret_cast<__m256i*>(store.data());
+    __m256i* pLoad = reinterpret_cast<__m256i*>(load.data());
+    __m256i* pE = reinterpret_cast<__m256i*>(gapE.data());
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i vBias = _mm256_set1_epi8(static_cast<char>(bias));
+    const __m256i vOpen = _mm256_set1_epi8(static_cast<char>(scoring.gapOpen));
+    const __m256i vExtend = _mm256_set1_epi8(static_cast<char>(scoring.gapExtend));
+    const int limit = 255 - bias;
+
+    for (size_t i = 0; i < query.rows.size(); ++i) {
+        const __m256i* prof = reinterpret_cast<const __m256i*>(profile.data() + query.rows[i] * segLen * LANES);
+        __m256i vF = zero, vMax = zero;
+        __m256i vH = shiftLanes8AVX2(_mm256_loadu_si256(pStore + segLen - 1));
+        std::swap(pStore, pLoad);
+
+        for (size_t s = 0; s < segLen; ++s) {
+            vH = _mm256_subs_epu8(_mm256_adds_epu8(vH, _mm256_loadu_si256(prof + s)), vBias);
+            __m256i vE = _mm256_loadu_si256(pE + s);
+            vH = _mm256_max_epu8(_mm256_max_epu8(vH, vE), vF);
+            vMax = _mm256_max_epu8(vMax, vH);
+            _mm256_storeu_si256(pStore + s, vH);
+            __m256i vHOpen = _mm256_subs_epu8(vH, vOpen);
+            _mm256_storeu_si256(pE + s, _mm256_max_epu8(_mm256_subs_epu8(vE, vExtend), vHOpen));
+            vF = _mm256_max_epu8(_mm256_subs_epu8(vF, vExtend), vHOpen);
+            vH = _mm256_loadu_si256(pLoad + s);
+        }
+
+        vF = shiftLanes8AVX2(vF);
+        for (size_t s = 0;;) {
+            __m256i vHs = _mm256_loadu_si256(pStore + s);
+            __m256i gain = _mm256_subs_epu8(vF, _mm256_subs_epu8(vHs, vOpen));
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(gain, zero)) == -1) break;
+            vHs = _mm256_max_epu8(vHs, vF);
+            vMax = _mm256_max_epu8(vMax, vHs);
+            _mm256_storeu_si256(pStore + s, vHs);
+            _mm256_storeu_si256(pE + s, _mm256_max_epu8(_mm256_loadu_si256(pE + s), _mm256_subs_epu8(vHs, vOpen)));
+            vF = _mm256_subs_epu8(vF, vExtend);
+            if (++s == segLen) {
+                s = 0;
+                vF = shiftLanes8AVX2(vF);
+            }
+        }
+
+        int rowMax = maxEpu8SSE41(_mm_max_epu8(_mm256_castsi256_si128(vMax), _mm256_extracti128_si256(vMax, 1)));
+        if (rowMax >= limit) return false;
+        if (rowMax > hit.score) {
+            hit.score = rowMax;
+            hit.endI = i + 1;
+            std::memcpy(bestRow.data(), pStore, bestRow.size());
+        }
+    }
+    if (hit.score > 0) hit.endJ = stripedColumnOf(bestRow, m, LANES, hit.score);
+    return true;
+}
+
+__attribute__((target("avx2")))
+inline bool stripedWordAVX2(const StripedQuery& query, const std::string& seq2,
+                            const ScoringScheme& scoring, StripedHit& hit) {
+    const size_t LANES = 16;
+    size_t m = seq2.size();
+    size_t segLen = (m + LANES - 1) / LANES;
+    std::vector<int16_t> profile = buildStripedProfile<int16_t>(seq2, query, scoring, LANES, 0, -0x4000);
+    std::vector<int16_t> store(segLen * LANES), load(segLen * LANES), gapE(segLen * LANES), bestRow(segLen * LANES);
+    __m256i* pStore = reinterpret_cast<__m256i*>(store.data());
+    __m256i* pLoad = reinterpret_cast<__m256i*>(load.data());
+    __m256i* pE = reinterpret_cast<__m256i*>(gapE.data());
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i vOpen = _mm256_set1_epi16(static_cast<short>(scoring.gapOpen));
+    const __m256i vExtend = _mm256_set1_epi16(static_cast<short>(scoring.gapExtend));
+    const int limit = 0x7FFF - std::max(scoring.match, 0);
+
+    for (size_t i = 0; i < query.rows.size(); ++i) {
+        const __m256i* prof = reinterpret_cast<const __m256i*>(profile.data() + query.rows[i] * segLen * LANES);
+        __m256i vF = zero, vMax = zero;
+        __m256i vH = shiftLanes16AVX2(_mm256_loadu_si256(pStore + segLen - 1));
+        std::swap(pStore, pLoad);
+
+        for (size_t s = 0; s < segLen; ++s) {
+            vH = _mm256_max_epi16(_mm256_adds_epi16(vH, _mm256_loadu_si256(prof + s)), zero);
+            __m256i vE = _mm256_loadu_si256(pE + s);
+            vH = _mm256_max_epi16(_mm256_max_epi16(vH, vE), vF);
+            vMax = _mm256_max_epi16(vMax, vH);
+            _mm256_storeu_si256(pStore + s, vH);
+            __m256i vHOpen = _mm256_subs_epi16(vH, vOpen);
+            _mm256_storeu_si256(pE + s, _mm256_max_epi16(_mm256_subs_epi16(vE, vExtend), vHOpen));
+            vF = _mm256_max_epi16(_mm256_subs_epi16(vF, vExtend), vHOpen);
+            vH = _mm256_loadu_si256(pLoad + s);
+        }
+
+        vF = shiftLanes16AVX2(vF);
+        for (size_t s = 0;;) {
+            __m256i vHs = _mm256_loadu_si256(pStore + s);
+            if (_mm256_movemask_epi8(_mm256_cmpgt_epi16(vF, _mm256_max_epi16(_mm256_subs_epi16(vHs, vOpen), zero))) == 0) break;
+            vHs = _mm256_max_epi16(vHs, vF);
+            vMax = _mm256_max_epi16(vMax, vHs);
+            _mm256_storeu_si256(pStore + s, vHs);
+            _mm256_storeu_si256(pE + s, _mm256_max_epi16(_mm256_loadu_si256(pE + s), _mm256_subs_epi16(vHs, vOpen)));
+            vF = _mm256_subs_epi16(vF, vExtend);
+            if (++s == segLen) {
+                s = 0;
+                vF = shiftLanes16AVX2(vF);
+            }
+        }
+
+        int rowMax = maxEpi16SSE41(_mm_max_epi16(_mm256_castsi256_si128(vMax), _mm256_extracti128_si256(vMax, 1)));
+        if (rowMax >= limit) return false;
+        if (rowMax > hit.score) {
+            hit.score = rowMax;
+            hit.endI = i + 1;
+            std::memcpy(bestRow.data(), pStore, bestRow.size() * sizeof(int16_t));
+        }
+    }
+    if (hit.score > 0) hit.endJ = stripedColumnOf(bestRow, m, LANES, hit.score);
+    return true;
+}
+
+#endif
+
+inline bool stripedKernelSupported(StripedKernel kernel) {
+#ifdef STRIPED_SW_X86
+    __builtin_cpu_init();
+    switch (kernel) {
+        case StripedKernel::SSE41: return __builtin_cpu_supports("sse4.1");
+        case StripedKernel::AVX2: return __builtin_cpu_supports("avx2");
+        default: return true;
+    }
+#else
+    return kernel == StripedKernel::Scalar;
+#endif
+}
+
+// Widest kernel the CPU supports, probed once via CPUID
+inline StripedKernel bestStripedKernel() {
+    static const StripedKernel best = [] {
+        if (stripedKernelSupported(StripedKernel::AVX2)) return StripedKernel::AVX2;
+        if (stripedKernelSupported(StripedKernel::SSE41)) return StripedKernel::SSE41;
+        return StripedKernel::Scalar;
+    }();
+    return best;
+}
+
+// Best local alignment score of seq1 against seq2 and where it ends. Tries
+// 8-bit lanes, then 16-bit lanes, then the scalar two-row fill.
+inline StripedHit stripedLocalAlignment(const std::string& seq1, const std::string& seq2,
+                                        const ScoringScheme& scoring = ScoringScheme(),
+                                        StripedKernel kernel = bestStripedKernel()) {
+    StripedHit hit;
+    if (seq1.empty() || seq2.empty()) return hit;
+
+#ifdef STRIPED_SW_X86
+    if (kernel != StripedKernel::Scalar) {
+        StripedQuery query = buildStripedQuery(seq1);
+        bool byteFits = std::max(scoring.match, -scoring.mismatch) < 128 &&
+                        scoring.gapOpen < 256 && scoring.gapExtend < 256;
+        bool avx2 = kernel == StripedKernel::AVX2;
+        if (byteFits && (avx2 ? stripedByteAVX2(query, seq2, scoring, hit)
+                              : stripedByteSSE41(query, seq2, scoring, hit))) {
+            return hit;
+        }
+        hit = StripedHit();
+        if (avx2 ? stripedWordAVX2(query, seq2, scoring, hit)
+                 : stripedWordSSE41(query, seq2, scoring, hit)) {
+            return hit;
+        }
+    }
+#endif
+    (void)kernel;
+    return scalarLocalHit(seq1, seq2, scoring);
+}
+
+#endif
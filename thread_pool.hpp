@@ -0,0 +1,153 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <type_traits>
+
+// Fixed-size pool of worker threads with one task deque per worker. Tasks
+// submitted from outside are dealt round-robin, tasks submitted by a worker
+// go to its own deque. Workers run their own deque oldest first and, once it
+// is empty, steal the newest task from another worker, so uneven tasks (long
+// alignments next to short ones) do not leave threads idle.
+class ThreadPool {
+public:
+    static const size_t NO_WORKER = static_cast<size_t>(-1);
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable available;
+    size_t unclaimed = 0;  // queued tasks no worker has claimed yet
+    bool stopping = false;
+    std::atomic<size_t> nextQueue{0};
+
+    // Pool and index of the worker running on this thread
+    struct WorkerIdentity {
+        const ThreadPool* pool = nullptr;
+        size_t index = NO_WORKER;
+    };
+
+    static WorkerIdentity& identity() {
+        thread_local WorkerIdentity current;
+        return current;
+    }
+
+    bool popOwn(size_t index, std::function<void()>& task) {
+        WorkerQueue& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+
+    bool steal(size_t index, std::function<void()>& task) {
+        for (size_t k = 1; k < queues.size(); ++k) {
+            WorkerQueue& victim = *queues[(index + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.tasks.empty()) continue;
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(size_t index) {
+        identity().pool = this;
+        identity().index = index;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                available.wait(lock, [this] { return stopping || unclaimed > 0; });
+                if (unclaimed == 0) return;  // stopping and drained
+                --unclaimed;
+            }
+            // Claims never exceed queued tasks, so one is there to be found
+            std::function<void()> task;
+            while (!popOwn(index, task) && !steal(index, task)) {
+                std::this_thread::yield();
+            }
+            task();
+        }
+    }
+
+public:
+    // threads == 0 uses every hardware thread
+    explicit ThreadPool(size_t threads = 0) {
+        if (threads == 0) threads = defaultThreadCount();
+        queues.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            queues.push_back(std::make_unique<WorkerQueue>());
+        }
+        workers.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    // Finishes every queued task, then joins the workers
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        available.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    static size_t defaultThreadCount() {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        return hardware == 0 ? 1 : hardware;
+    }
+
+    size_t size() const { return workers.size(); }
+
+    // Index (0 .. size()-1) of the worker running the calling task, for
+    // per-thread scratch buffers; NO_WORKER outside this pool's workers
+    size_t workerIndex() const {
+        return identity().pool == this ? identity().index : NO_WORKER;
+    }
+
+    // Queue fn and return a future for its result
+    template <typename Fn>
+    auto submit(Fn&& fn) -> std::future<typename std::invoke_result<Fn>::type> {
+        using Result = typename std::invoke_result<Fn>::type;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+        std::future<Result> result = task->get_future();
+
+        size_t index = workerIndex();
+        if (index == NO_WORKER) index = nextQueue++ % queues.size();
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.emplace_back([task] { (*task)(); });
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++unclaimed;
+        }
+        available.notify_one();
+        return result;
+    }
+};
+
+#endif